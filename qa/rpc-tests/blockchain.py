@@ -23,6 +23,9 @@ class BlockchainTest(BitcoinTestFramework):
     Test blockchain-related RPC calls:
 
         - gettxoutsetinfo
+        - scantxoutset
+        - dumputxoset
+        - loadutxoset
         - getblockheader
         - getblock
         - rollbackchain
@@ -49,10 +52,13 @@ class BlockchainTest(BitcoinTestFramework):
     def run_test(self):
         self._test_getblockchaininfo()
         self._test_gettxoutsetinfo()
+        self._test_scantxoutset()
+        self._test_utxosnapshot()
         self._test_getblockheader()
         self._test_getblock()
         self._test_rollbackchain_and_reconsidermostworkchain()
         self._test_transaction_pools()
+        self._test_utxosnapshot_load()
         self.nodes[0].verifychain(4, 0)
 
     def _test_getblockchaininfo(self):
@@ -108,6 +114,15 @@ class BlockchainTest(BitcoinTestFramework):
         assert_equal(res['bestblock'], node.getblockhash(200))
         assert_equal(len(res['bestblock']), 64)
         assert_equal(len(res['hash_serialized_2']), 64)
+        assert_equal(len(res['hash_serialized_3']), 64)
+        assert_equal(len(res['utxo_commitment']), 64)
+
+        logging.info ("Test that the fast gettxoutsetinfo() returns the same commitment")
+        fast = node.gettxoutsetinfo(True)
+        assert_equal(sorted(fast.keys()), ['bestblock', 'height', 'utxo_commitment'])
+        assert_equal(fast['bestblock'], res['bestblock'])
+        assert_equal(fast['height'], res['height'])
+        assert_equal(fast['utxo_commitment'], res['utxo_commitment'])
 
         logging.info ("Test that gettxoutsetinfo() works for blockchain with just the genesis block")
         b1hash = node.getblockhash(1)
@@ -120,6 +135,10 @@ class BlockchainTest(BitcoinTestFramework):
         assert_equal(res2['txouts'], 0)
         assert_equal(res2['bestblock'], node.getblockhash(0))
         assert_equal(len(res2['hash_serialized_2']), 64)
+        assert_equal(len(res2['hash_serialized_3']), 64)
+        # The genesis coinbase is not spendable, so the set is empty
+        assert_equal(res2['utxo_commitment'], '00' * 32)
+        assert_equal(node.gettxoutsetinfo(True)['utxo_commitment'], '00' * 32)
 
         logging.info ("Test that gettxoutsetinfo() returns the same result after invalidate/reconsider block")
         node.reconsiderblock(b1hash)
@@ -131,6 +150,98 @@ class BlockchainTest(BitcoinTestFramework):
         assert_equal(res['txouts'], res3['txouts'])
         assert_equal(res['bestblock'], res3['bestblock'])
         assert_equal(res['hash_serialized_2'], res3['hash_serialized_2'])
+        assert_equal(res['hash_serialized_3'], res3['hash_serialized_3'])
+        assert_equal(res['utxo_commitment'], res3['utxo_commitment'])
+        assert_equal(node.gettxoutsetinfo(True)['utxo_commitment'], res['utxo_commitment'])
+
+    def _test_scantxoutset(self):
+        node = self.nodes[0]
+        logging.info ("Test that scantxoutset() finds the coins of a script or an address")
+        coinbase = node.getblock(node.getblockhash(1))['tx'][0]
+        txout = node.gettxout(coinbase, 0)
+        script = txout['scriptPubKey']['hex']
+        res = node.scantxoutset([script])
+        assert_equal(res['success'], True)
+        assert_equal(res['searched_items'], node.gettxoutsetinfo()['txouts'])
+        assert_equal(res['bestblock'], node.getbestblockhash())
+        assert(coinbase in [u['txid'] for u in res['unspents']])
+        assert(all(u['scriptPubKey'] == script for u in res['unspents']))
+        assert_equal(res['total_amount'], sum(u['amount'] for u in res['unspents']))
+        res2 = node.scantxoutset([txout['scriptPubKey']['addresses'][0]])
+        assert_equal(res2['unspents'], res['unspents'])
+        assert_equal(node.scantxoutset(["51"])['unspents'], [])
+        assert_raises_rpc_error(-5, "Invalid address or script", node.scantxoutset, ["nonsense"])
+
+    def _test_utxosnapshot(self):
+        node = self.nodes[0]
+        info = node.gettxoutsetinfo()
+
+        logging.info ("Test that dumputxoset() writes every coin and the commitment")
+        res = node.dumputxoset("utxo.dat")
+        assert_equal(res['coins_written'], info['txouts'])
+        assert_equal(res['base_hash'], info['bestblock'])
+        assert_equal(res['base_height'], info['height'])
+        assert_equal(res['utxo_commitment'], info['utxo_commitment'])
+        assert(os.path.isfile(res['path']))
+        assert_raises_rpc_error(-8, "already exists", node.dumputxoset, "utxo.dat")
+
+        logging.info ("Test that loadutxoset() refuses snapshots that can not replace the UTXO set")
+        commitment = res['utxo_commitment']
+        assert_raises_rpc_error(None, None, node.loadutxoset, "utxo.dat")
+        assert_raises_rpc_error(-20, "already the tip", node.loadutxoset, "utxo.dat", commitment)
+        assert_raises_rpc_error(-20, "not the expected", node.loadutxoset, "utxo.dat", "00" * 32)
+        assert_raises_rpc_error(-20, "Unable to open", node.loadutxoset, "nonexistent.dat", commitment)
+        b190hash = node.getblockhash(190)
+        node.invalidateblock(b190hash)
+        assert_raises_rpc_error(-20, "is invalid", node.loadutxoset, "utxo.dat", commitment)
+        node.reconsiderblock(b190hash)
+        assert_equal(node.gettxoutsetinfo(True)['utxo_commitment'], info['utxo_commitment'])
+
+        logging.info ("Test that loadutxoset() refuses a snapshot whose coins do not match its commitment")
+        with open(res['path'], 'r+b') as f:
+            f.seek(-1, os.SEEK_END)
+            last = f.read(1)
+            f.seek(-1, os.SEEK_END)
+            f.write(bytes([last[0] ^ 1]))
+        assert_raises_rpc_error(-20, "", node.loadutxoset, "utxo.dat", commitment)
+        assert_equal(node.gettxoutsetinfo(True)['utxo_commitment'], info['utxo_commitment'])
+
+    def _test_utxosnapshot_load(self):
+        node = self.nodes[0]
+        # The blocks up to a loaded snapshot can not be disconnected again, so keep node1 out of this
+        disconnect_all(self.nodes[1])
+        disconnect_all(node)
+
+        logging.info ("Test that loadutxoset() makes the block of the snapshot the tip")
+        base_hash = node.getbestblockhash()
+        base_height = node.getblockcount()
+        res = node.dumputxoset("utxo_load.dat")
+        # Leave the block of the snapshot downloaded but not connected, with its parent as the tip
+        node.invalidateblock(base_hash)
+        fork = node.generate(2)
+        node.reconsiderblock(base_hash)
+        assert_equal(node.getbestblockhash(), fork[-1])
+        node.rollbackchain(base_height - 1)
+        assert_equal(node.getblockcount(), base_height - 1)
+        ret = node.loadutxoset("utxo_load.dat", res['utxo_commitment'])
+        assert_equal(ret['base_hash'], base_hash)
+        assert_equal(ret['base_height'], base_height)
+        assert_equal(ret['coins_loaded'], res['coins_written'])
+        assert_equal(node.getbestblockhash(), base_hash)
+        assert_equal(node.gettxoutsetinfo(True)['utxo_commitment'], res['utxo_commitment'])
+
+        logging.info ("Test that blocks are connected on top of a loaded snapshot")
+        next_hash = node.generate(1)[0]
+        assert_equal(node.getblockcount(), base_height + 1)
+        info = node.gettxoutsetinfo()
+        assert_equal(info['bestblock'], next_hash)
+        assert_equal(node.gettxoutsetinfo(True)['utxo_commitment'], info['utxo_commitment'])
+
+        logging.info ("Test that the block of a loaded snapshot can not be disconnected")
+        assert_raises_rpc_error(None, "can not be disconnected", node.rollbackchain, base_height - 1)
+        assert_equal(node.getbestblockhash(), base_hash)
+        node.reconsiderblock(next_hash)
+        assert_equal(node.getbestblockhash(), next_hash)
 
     def _test_getblockheader(self):
         node = self.nodes[0]
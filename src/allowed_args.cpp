@@ -289,7 +289,16 @@ static void addGeneralOptions(AllowedArgs &allowedArgs, HelpMessageMode mode)
     allowedArgs
         .addArg("dbcache=<n>", requiredInt, strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"),
                                                 nMinDbCache, nMaxDbCache, nDefaultDbCache))
+        .addArg("dbwritebehind", optionalBool,
+            strprintf(_("Write periodic flushes of the UTXO cache to the database in the background (default: %u)"),
+                    DEFAULT_DB_WRITE_BEHIND))
         .addArg("loadblock=<file>", requiredStr, _("Imports blocks from external blk000??.dat file on startup"))
+        .addArg("loadutxoset=<file>", requiredStr,
+            _("Replace the UTXO set with a snapshot written by dumputxoset on startup.  The block of the snapshot "
+              "and its ancestors must already be downloaded"))
+        .addArg("loadutxosetcommitment=<hash>", requiredStr,
+            _("The UTXO set commitment that the snapshot of -loadutxoset must have, as reported by dumputxoset or "
+              "gettxoutsetinfo on a node that you trust.  Required with -loadutxoset"))
         .addArg("maxorphantx=<n>", requiredInt,
             strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"),
                     DEFAULT_MAX_ORPHAN_TRANSACTIONS))
@@ -860,16 +869,27 @@ BitcoinBench::BitcoinBench() : AllowedArgs(true)
             strprintf("Regular expression filter to select benchmark by name (default: %s)", DEFAULT_BENCH_FILTER))
         .addArg("-scaling=<n>", ::AllowedArgs::requiredInt,
             strprintf("Scaling factor for benchmark's runtime (default: %u)", DEFAULT_BENCH_SCALING))
-        .addArg("-printer=(console|plot)", ::AllowedArgs::requiredStr,
-            strprintf("Choose printer format. console: print data to console. plot: Print results as HTML graph "
-                      "(default: %s)",
+        .addArg("-printer=(console|plot|json)", ::AllowedArgs::requiredStr,
+            strprintf("Choose printer format. console: print data to console. plot: Print results as HTML graph. "
+                      "json: Print results and counters as JSON (default: %s)",
                     DEFAULT_BENCH_PRINTER))
         .addArg("-plot-plotlyurl=<uri>", ::AllowedArgs::requiredInt,
             strprintf("URL to use for plotly.js (default: %s)", DEFAULT_PLOT_PLOTLYURL))
         .addArg("-plot-width=<x>", ::AllowedArgs::requiredInt,
             strprintf("Plot width in pixel (default: %u)", DEFAULT_PLOT_WIDTH))
         .addArg("-plot-height=<x>", ::AllowedArgs::requiredInt,
-            strprintf("Plot height in pixel (default: %u)", DEFAULT_PLOT_HEIGHT));
+            strprintf("Plot height in pixel (default: %u)", DEFAULT_PLOT_HEIGHT))
+        .addArg("-blockrelay-txs=<n>", ::AllowedArgs::requiredInt,
+            strprintf("Number of transactions in the blocks of the block relay benchmarks (default: %u)",
+                DEFAULT_BLOCKRELAY_TXS))
+        .addArg("-blockrelay-mempool=<n>", ::AllowedArgs::requiredInt,
+            strprintf("Number of transactions in the receiver's mempool that are not in the block, for the block "
+                      "relay benchmarks (default: %u)",
+                DEFAULT_BLOCKRELAY_MEMPOOL))
+        .addArg("-blockrelay-overlap=<n>", ::AllowedArgs::requiredInt,
+            strprintf("Percentage of the transactions of the block that the receiver already has, for the block "
+                      "relay benchmarks (default: %u)",
+                DEFAULT_BLOCKRELAY_OVERLAP));
 };
 
 Bitcoind::Bitcoind(CTweakMap *pTweaks) : AllowedArgs(false) { addAllNodeOptions(*this, HMM_BITCOIND, pTweaks); }
@@ -16,7 +16,7 @@ using namespace benchmark;
 
 void benchmark::ConsolePrinter::header()
 {
-    std::cout << "# Benchmark, evals, iterations, total, min, max, median" << std::endl;
+    std::cout << "# Benchmark, evals, iterations, total, min, max, median[, counter=value...]" << std::endl;
 }
 
 void benchmark::ConsolePrinter::result(const State &state)
@@ -45,7 +45,10 @@ void benchmark::ConsolePrinter::result(const State &state)
 
     std::cout << std::setprecision(6);
     std::cout << state.m_name << ", " << state.m_num_evals << ", " << state.m_num_iters << ", " << total << ", "
-              << front << ", " << back << ", " << median << std::endl;
+              << front << ", " << back << ", " << median;
+    for (const auto &counter : state.m_counters)
+        std::cout << ", " << counter.first << "=" << counter.second;
+    std::cout << std::endl;
 }
 
 void benchmark::ConsolePrinter::footer() {}
@@ -86,6 +89,28 @@ void benchmark::PlotlyPrinter::footer()
               << "</script></body></html>";
 }
 
+void benchmark::JsonPrinter::header() {}
+void benchmark::JsonPrinter::result(const State &state)
+{
+    UniValue elapsed(UniValue::VARR);
+    for (const auto &e : state.m_elapsed_results)
+        elapsed.push_back(e);
+
+    UniValue counters(UniValue::VOBJ);
+    for (const auto &counter : state.m_counters)
+        counters.pushKV(counter.first, counter.second);
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("name", state.m_name);
+    result.pushKV("evals", state.m_num_evals);
+    result.pushKV("iterations", state.m_num_iters);
+    result.pushKV("elapsed", elapsed);
+    result.pushKV("counters", counters);
+    m_results.push_back(result);
+}
+
+void benchmark::JsonPrinter::footer() { std::cout << m_results.write(2) << std::endl; }
+
 benchmark::BenchRunner::BenchmarkMap &benchmark::BenchRunner::benchmarks()
 {
     static std::map<std::string, Bench> benchmarks_map;
@@ -13,6 +13,8 @@
 #include <string>
 #include <vector>
 
+#include <univalue.h>
+
 #include <boost/preprocessor/cat.hpp>
 #include <boost/preprocessor/stringize.hpp>
 
@@ -63,6 +65,8 @@ public:
     const uint64_t m_num_evals;
     std::vector<double> m_elapsed_results;
     time_point m_start_time;
+    // Other results of a benchmark besides its timings, such as the size of what it encoded, by name
+    std::map<std::string, double> m_counters;
 
     bool UpdateTimer(time_point finish_time);
 
@@ -140,6 +144,18 @@ private:
     int64_t m_width;
     int64_t m_height;
 };
+
+// prints all the timings and counters of every benchmark as one JSON array, for tracking them across releases.
+class JsonPrinter : public Printer
+{
+public:
+    void header() override;
+    void result(const State &state) override;
+    void footer() override;
+
+private:
+    UniValue m_results{UniValue::VARR};
+};
 }
 
 // BENCHMARK(foo, num_iters_for_one_second) expands to:  benchmark::BenchRunner bench_11foo("foo", num_iterations);
@@ -8,6 +8,7 @@
 #include "allowed_args.h"
 #include "bench/bench_constants.h"
 #include "crypto/sha256.h"
+#include "hashwrapper.h"
 #include "key.h"
 #include "main.h"
 #include "rpc/client.h"
@@ -45,6 +46,7 @@ int main(int argc, char *argv[])
 
     double scaling_factor = boost::lexical_cast<double>(scaling_str);
 
+    SipHashAutoDetect();
 
     std::unique_ptr<benchmark::Printer> printer(new benchmark::ConsolePrinter());
     std::string printer_arg = GetArg("-printer", DEFAULT_BENCH_PRINTER);
@@ -53,6 +55,10 @@ int main(int argc, char *argv[])
         printer.reset(new benchmark::PlotlyPrinter(GetArg("-plot-plotlyurl", DEFAULT_PLOT_PLOTLYURL),
             GetArg("-plot-width", DEFAULT_PLOT_WIDTH), GetArg("-plot-height", DEFAULT_PLOT_HEIGHT)));
     }
+    else if ("json" == printer_arg)
+    {
+        printer.reset(new benchmark::JsonPrinter());
+    }
 
     benchmark::BenchRunner::RunAll(*printer, evaluations, scaling_factor, regex_filter, is_list_only);
 }
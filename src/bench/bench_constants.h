@@ -12,5 +12,8 @@ static const char *DEFAULT_BENCH_PRINTER = "console";
 static const char *DEFAULT_PLOT_PLOTLYURL = "https://cdn.plot.ly/plotly-latest.min.js";
 static const int64_t DEFAULT_PLOT_WIDTH = 1024;
 static const int64_t DEFAULT_PLOT_HEIGHT = 768;
+static const int64_t DEFAULT_BLOCKRELAY_TXS = 2000;
+static const int64_t DEFAULT_BLOCKRELAY_MEMPOOL = 2000;
+static const int64_t DEFAULT_BLOCKRELAY_OVERLAP = 99;
 
 #endif
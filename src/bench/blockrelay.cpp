@@ -0,0 +1,512 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "bench/bench_constants.h"
+#include "blockrelay/compactblock.h"
+#include "blockrelay/graphene.h"
+#include "blockrelay/thinblock.h"
+#include "bloom.h"
+#include "consensus/merkle.h"
+#include "iblt.h"
+#include "random.h"
+#include "shortidindex.h"
+#include "streams.h"
+#include "test/test_bitcoin.h"
+#include "txmempool.h"
+#include "unlimited.h"
+#include "util.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+/*
+ * Benchmarks of encoding a block for relay with xthin, compact blocks, graphene and a plain IBLT, and of decoding it
+ * again at a receiver from the transactions in its mempool.  The block and the receiver's mempool are made up; their
+ * sizes and how much they overlap are set with -blockrelay-txs, -blockrelay-mempool and -blockrelay-overlap.
+ *
+ * Besides the timings every benchmark reports counters: the encode benchmarks the serialized size of what is sent,
+ * and the decode benchmarks the average number of transactions the receiver has to ask for afterwards and the rate at
+ * which decoding fails, so that the block has to be sent some other way.  The counters also hold the scenario, so
+ * that the output of -printer=json can be compared across releases.
+ *
+ * Encoding is done by the node's own code.  Decoding uses the node's deserialization, short id lookups in the
+ * mempool and graphene set reconciliation, and for graphene also the node's steps that order the found transactions
+ * and check them against the merkle root.  The rest of the xthin and compact block decoders, which put the block
+ * together from the transactions that were found, are models of the node's: the node's versions of those steps work
+ * on a peer and the blocks in flight from it (CXThinBlock::process and CompactBlock::process), so a regression there
+ * does not show up in these numbers.
+ */
+
+// The decode benchmarks cycle through this many encodings of the block, each with its own salt
+static const size_t NUM_ENCODINGS = 16;
+// The bits of the SipHash of a txid that are the short id in a compact block
+static const uint64_t COMPACT_SHORTID_MASK = 0xffffffffffffL;
+
+struct RelayScenario
+{
+    int64_t nTxs = 0;
+    int64_t nMempool = 0;
+    int64_t nOverlap = 0;
+
+    CBlock block;
+    //! The receiver's mempool, and the txids in it
+    CTxMemPool pool;
+    std::vector<uint256> vReceiverTxids;
+    //! The transactions the sender of a compact block knows the receiver has
+    std::unique_ptr<CRollingFastFilter<4 * 1024 * 1024> > pInventoryKnown;
+
+    void AddCounters(benchmark::State &state) const
+    {
+        state.m_counters["txs"] = nTxs;
+        state.m_counters["mempool"] = nMempool;
+        state.m_counters["overlap"] = nOverlap;
+    }
+};
+
+// A transaction of about the size of a payment with one input and two outputs
+static CTransactionRef RandomTx(FastRandomContext &rng)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(rng.rand256(), rng.randrange(4));
+    tx.vin[0].scriptSig = CScript() << rng.randbytes(72) << rng.randbytes(33);
+    tx.vout.resize(2);
+    for (CTxOut &txout : tx.vout)
+    {
+        txout.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << rng.randbytes(20) << OP_EQUALVERIFY << OP_CHECKSIG;
+        txout.nValue = 1000 + rng.randrange(COIN);
+    }
+    return MakeTransactionRef(tx);
+}
+
+static const RelayScenario &GetScenario()
+{
+    static std::unique_ptr<RelayScenario> pScenario;
+    if (pScenario)
+        return *pScenario;
+
+    pScenario.reset(new RelayScenario());
+    RelayScenario &scenario = *pScenario;
+    scenario.nTxs = std::max(GetArg("-blockrelay-txs", DEFAULT_BLOCKRELAY_TXS), (int64_t)2);
+    scenario.nMempool = std::max(GetArg("-blockrelay-mempool", DEFAULT_BLOCKRELAY_MEMPOOL), (int64_t)0);
+    scenario.nOverlap = std::min(std::max(GetArg("-blockrelay-overlap", DEFAULT_BLOCKRELAY_OVERLAP), (int64_t)0),
+        (int64_t)100);
+
+    // The same scenario every run, so that the results of different builds can be compared
+    FastRandomContext rng(true);
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << 700000 << rng.randbytes(8);
+    coinbase.vout.resize(1);
+    coinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    coinbase.vout[0].nValue = 50 * COIN;
+
+    // A block in canonical transaction order
+    std::vector<CTransactionRef> vBlockTxs;
+    for (int64_t i = 1; i < scenario.nTxs; i++)
+        vBlockTxs.push_back(RandomTx(rng));
+    std::sort(vBlockTxs.begin(), vBlockTxs.end(),
+        [](const CTransactionRef &a, const CTransactionRef &b) { return a->GetHash() < b->GetHash(); });
+    CBlock &block = scenario.block;
+    block.nVersion = 0x20000000;
+    block.hashPrevBlock = rng.rand256();
+    block.nTime = 1600000000;
+    block.nBits = 0x1d00ffff;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.vtx.insert(block.vtx.end(), vBlockTxs.begin(), vBlockTxs.end());
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+
+    // The receiver has some of the transactions of the block, and others besides
+    Shuffle(vBlockTxs.begin(), vBlockTxs.end(), rng);
+    vBlockTxs.resize(vBlockTxs.size() * scenario.nOverlap / 100);
+    for (int64_t i = 0; i < scenario.nMempool; i++)
+        vBlockTxs.push_back(RandomTx(rng));
+
+    TestMemPoolEntryHelper entry;
+    scenario.pInventoryKnown.reset(new CRollingFastFilter<4 * 1024 * 1024>());
+    for (const CTransactionRef &ptx : vBlockTxs)
+    {
+        scenario.pool.addUnchecked(ptx->GetHash(), entry.FromTx(*ptx));
+        scenario.vReceiverTxids.push_back(ptx->GetHash());
+        scenario.pInventoryKnown->insert(ptx->GetHash());
+    }
+    return scenario;
+}
+
+// The filter of its mempool that the receiver sends with its request for an xthin block
+static CBloomFilter ReceiverFilter(const RelayScenario &scenario, FastRandomContext &rng)
+{
+    CBloomFilter filter(std::max(scenario.vReceiverTxids.size(), (size_t)1), 0.0001, rng.rand32(), BLOOM_UPDATE_ALL);
+    for (const uint256 &txid : scenario.vReceiverTxids)
+        filter.insert(txid);
+    return filter;
+}
+
+// Whether the transactions that were found for a block are that block.  This is only known once none are missing.
+static bool IsBlock(const CBlockHeader &header, const std::vector<CTransactionRef> &vtx)
+{
+    CBlock block(header);
+    block.vtx = vtx;
+    return BlockMerkleRoot(block) == header.hashMerkleRoot;
+}
+
+struct DecodeResult
+{
+    //! The transactions the receiver has to ask for
+    size_t nMissing = 0;
+    //! Whether the block could not be decoded, and has to be sent some other way
+    bool fFailed = false;
+};
+
+struct DecodeStats
+{
+    size_t nDecodes = 0;
+    size_t nMissing = 0;
+    size_t nFailures = 0;
+
+    void Add(const DecodeResult &result)
+    {
+        nDecodes++;
+        nMissing += result.nMissing;
+        if (result.fFailed)
+            nFailures++;
+    }
+
+    void AddCounters(benchmark::State &state) const
+    {
+        state.m_counters["missing"] = nDecodes ? (double)nMissing / nDecodes : 0;
+        state.m_counters["failures"] = nDecodes ? (double)nFailures / nDecodes : 0;
+    }
+};
+
+static DecodeResult DecodeXThin(const RelayScenario &scenario, CDataStream ss)
+{
+    CXThinBlock thinBlock;
+    ss >> thinBlock;
+
+    DecodeResult result;
+    std::vector<uint256> vTxids;
+    if (scenario.pool.FindShortIds(CShortIdSalt(), thinBlock.vTxHashes, vTxids) > 0)
+    {
+        result.fFailed = true;
+        return result;
+    }
+
+    std::map<uint64_t, CTransactionRef> mapSent;
+    for (const CTransaction &tx : thinBlock.vMissingTx)
+        mapSent[tx.GetHash().GetCheapHash()] = MakeTransactionRef(tx);
+
+    std::vector<CTransactionRef> vtx(thinBlock.vTxHashes.size());
+    for (size_t i = 0; i < vtx.size(); i++)
+    {
+        auto it = mapSent.find(thinBlock.vTxHashes[i]);
+        if (it != mapSent.end())
+            vtx[i] = it->second;
+        else if (!vTxids[i].IsNull())
+            vtx[i] = scenario.pool.get(vTxids[i]);
+        if (vtx[i] == nullptr)
+            result.nMissing++;
+    }
+    if (result.nMissing == 0)
+        result.fFailed = !IsBlock(thinBlock.header, vtx);
+    return result;
+}
+
+static DecodeResult DecodeCompact(const RelayScenario &scenario, CDataStream ss)
+{
+    CompactBlock cmpctBlock;
+    ss >> cmpctBlock;
+
+    DecodeResult result;
+    const CShortIdSalt salt(cmpctBlock.shorttxidk0, cmpctBlock.shorttxidk1, COMPACT_SHORTID_MASK);
+    std::vector<uint256> vTxids;
+    if (scenario.pool.FindShortIds(salt, cmpctBlock.shorttxids, vTxids) > 0)
+    {
+        result.fFailed = true;
+        return result;
+    }
+
+    // The index of each prefilled transaction is counted from the one before it
+    std::vector<CTransactionRef> vtx(cmpctBlock.BlockTxCount());
+    int64_t nLastIndex = -1;
+    for (const PrefilledTransaction &prefilled : cmpctBlock.prefilledtxn)
+    {
+        nLastIndex += prefilled.index + 1;
+        if (nLastIndex >= (int64_t)vtx.size())
+        {
+            result.fFailed = true;
+            return result;
+        }
+        vtx[nLastIndex] = MakeTransactionRef(prefilled.tx);
+    }
+
+    size_t nShortId = 0;
+    for (CTransactionRef &ptx : vtx)
+    {
+        if (ptx != nullptr)
+            continue;
+        const uint256 &txid = vTxids[nShortId++];
+        if (!txid.IsNull())
+            ptx = scenario.pool.get(txid);
+        if (ptx == nullptr)
+            result.nMissing++;
+    }
+    if (result.nMissing == 0)
+        result.fFailed = !IsBlock(cmpctBlock.header, vtx);
+    return result;
+}
+
+static DecodeResult DecodeGraphene(const RelayScenario &scenario, CDataStream ss)
+{
+    CGrapheneBlock grapheneBlock(GRAPHENE_MAX_VERSION_SUPPORTED, true);
+    ss >> grapheneBlock;
+    const CGrapheneSet &grapheneSet = *grapheneBlock.pGrapheneSet;
+
+    // The receiver's transactions that pass the sender's filter, and those sent along with the block
+    const CShortIdSalt salt =
+        GetShortIdSalt(grapheneBlock.shorttxidk0, grapheneBlock.shorttxidk1, grapheneBlock.version);
+    std::vector<std::pair<uint64_t, uint256> > vShortIds;
+    scenario.pool.queryShortIds(salt, vShortIds);
+    std::map<uint64_t, CTransactionRef> mapTxs;
+    std::set<uint64_t> setFilterPositive;
+    for (const auto &item : vShortIds)
+    {
+        if (grapheneSet.GetFastFilter()->contains(item.second))
+        {
+            mapTxs.emplace(item.first, scenario.pool.get(item.second));
+            setFilterPositive.insert(item.first);
+        }
+    }
+    for (const CTransactionRef &ptx : grapheneBlock.vAdditionalTxs)
+    {
+        uint64_t nShortId = salt.GetShortID(ptx->GetHash());
+        mapTxs[nShortId] = ptx;
+        setFilterPositive.insert(nShortId);
+    }
+
+    DecodeResult result;
+    std::vector<uint64_t> vBlockShortIds;
+    try
+    {
+        vBlockShortIds = grapheneBlock.pGrapheneSet->Reconcile(setFilterPositive);
+    }
+    catch (const std::runtime_error &)
+    {
+        result.fFailed = true;
+        return result;
+    }
+
+    // The node's steps from here on: find the transactions of the short ids, put the coinbase first and the rest
+    // in canonical order, and check the merkle root
+    result.nMissing =
+        grapheneBlock.UpdateResolvedTxsAndIdentifyMissing(mapTxs, vBlockShortIds, grapheneBlock.version).size();
+    if (result.nMissing == 0)
+    {
+        auto itCoinbase = std::find_if(grapheneBlock.vAdditionalTxs.begin(), grapheneBlock.vAdditionalTxs.end(),
+            [](const CTransactionRef &ptx) { return ptx->IsCoinBase(); });
+        if (itCoinbase == grapheneBlock.vAdditionalTxs.end())
+        {
+            result.fFailed = true;
+            return result;
+        }
+        grapheneBlock.SituateCoinbase(*itCoinbase);
+        if (fCanonicalTxsOrder && grapheneBlock.version >= 1)
+            std::sort(grapheneBlock.vTxHashes256.begin() + 1, grapheneBlock.vTxHashes256.end());
+        bool fMutated = false;
+        const uint256 merkleRoot = ComputeMerkleRoot(grapheneBlock.vTxHashes256, &fMutated);
+        result.fFailed = fMutated || merkleRoot != grapheneBlock.header.hashMerkleRoot;
+    }
+    return result;
+}
+
+// The IBLT of the short ids of the block, made the way graphene makes them and sized for the transactions that the
+// receiver does not have
+static CIblt BlockIblt(const RelayScenario &scenario, uint32_t nSalt)
+{
+    size_t nDifference = (scenario.block.vtx.size() - 1) * (100 - scenario.nOverlap) / 100 + 1;
+    CIblt iblt = CGrapheneSet::ConstructIblt(scenario.vReceiverTxids.size(), nDifference, 1.0, nSalt,
+        CGrapheneBlock::GetGrapheneSetVersion(GRAPHENE_MAX_VERSION_SUPPORTED), 0);
+    for (const CTransactionRef &ptx : scenario.block.vtx)
+        iblt.insert(ptx->GetHash().GetCheapHash(), IBLT_NULL_VALUE);
+    return iblt;
+}
+
+static DecodeResult DecodeIblt(const RelayScenario &scenario, CDataStream ss)
+{
+    CIblt senderIblt;
+    ss >> senderIblt;
+
+    // Of the receiver's transactions, only those in the block are in its IBLT, as if the sender's filter had no false
+    // positives.  The coinbase is always sent along with the block.
+    CIblt receiverIblt(senderIblt);
+    receiverIblt.reset();
+    std::set<uint64_t> setBlockShortIds;
+    for (const CTransactionRef &ptx : scenario.block.vtx)
+        setBlockShortIds.insert(ptx->GetHash().GetCheapHash());
+    for (const uint256 &txid : scenario.vReceiverTxids)
+    {
+        if (setBlockShortIds.count(txid.GetCheapHash()))
+            receiverIblt.insert(txid.GetCheapHash(), IBLT_NULL_VALUE);
+    }
+    receiverIblt.insert(scenario.block.vtx[0]->GetHash().GetCheapHash(), IBLT_NULL_VALUE);
+
+    DecodeResult result;
+    std::set<std::pair<uint64_t, std::vector<uint8_t> > > senderHas;
+    std::set<std::pair<uint64_t, std::vector<uint8_t> > > receiverHas;
+    result.fFailed = !(senderIblt - receiverIblt).listEntries(senderHas, receiverHas) || !receiverHas.empty();
+    result.nMissing = senderHas.size();
+    return result;
+}
+
+template <typename T>
+static CDataStream Serialize(const T &obj)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << obj;
+    return ss;
+}
+
+static void XThinEncode(benchmark::State &state)
+{
+    const RelayScenario &scenario = GetScenario();
+    FastRandomContext rng(true);
+    const CBloomFilter filter = ReceiverFilter(scenario, rng);
+
+    size_t nBytes = 0;
+    while (state.KeepRunning())
+        nBytes = Serialize(CXThinBlock(scenario.block, &filter)).size();
+
+    scenario.AddCounters(state);
+    state.m_counters["bytes"] = nBytes;
+    state.m_counters["requestbytes"] = ::GetSerializeSize(filter, SER_NETWORK, PROTOCOL_VERSION);
+}
+
+static void XThinDecode(benchmark::State &state)
+{
+    const RelayScenario &scenario = GetScenario();
+    FastRandomContext rng(true);
+    std::vector<CDataStream> vEncodings;
+    for (size_t i = 0; i < NUM_ENCODINGS; i++)
+    {
+        const CBloomFilter filter = ReceiverFilter(scenario, rng);
+        vEncodings.push_back(Serialize(CXThinBlock(scenario.block, &filter)));
+    }
+
+    DecodeStats stats;
+    while (state.KeepRunning())
+        stats.Add(DecodeXThin(scenario, vEncodings[stats.nDecodes % NUM_ENCODINGS]));
+
+    scenario.AddCounters(state);
+    stats.AddCounters(state);
+}
+
+static void CompactEncode(benchmark::State &state)
+{
+    const RelayScenario &scenario = GetScenario();
+
+    size_t nBytes = 0;
+    size_t nPrefilled = 0;
+    while (state.KeepRunning())
+    {
+        CompactBlock cmpctBlock(scenario.block, scenario.pInventoryKnown.get());
+        nBytes = Serialize(cmpctBlock).size();
+        nPrefilled = cmpctBlock.prefilledtxn.size();
+    }
+
+    scenario.AddCounters(state);
+    state.m_counters["bytes"] = nBytes;
+    state.m_counters["prefilled"] = nPrefilled;
+}
+
+static void CompactDecode(benchmark::State &state)
+{
+    const RelayScenario &scenario = GetScenario();
+    std::vector<CDataStream> vEncodings;
+    for (size_t i = 0; i < NUM_ENCODINGS; i++)
+        vEncodings.push_back(Serialize(CompactBlock(scenario.block, scenario.pInventoryKnown.get())));
+
+    DecodeStats stats;
+    while (state.KeepRunning())
+        stats.Add(DecodeCompact(scenario, vEncodings[stats.nDecodes % NUM_ENCODINGS]));
+
+    scenario.AddCounters(state);
+    stats.AddCounters(state);
+}
+
+// A graphene block for a sender whose mempool is as large as the receiver's
+static CGrapheneBlock MakeGrapheneBlock(const RelayScenario &scenario)
+{
+    size_t nReceiverTxs = scenario.vReceiverTxids.size();
+    return CGrapheneBlock(std::make_shared<CBlock>(scenario.block), nReceiverTxs,
+        nReceiverTxs + scenario.block.vtx.size() - 1, GRAPHENE_MAX_VERSION_SUPPORTED, true);
+}
+
+static void GrapheneEncode(benchmark::State &state)
+{
+    const RelayScenario &scenario = GetScenario();
+
+    size_t nBytes = 0;
+    while (state.KeepRunning())
+        nBytes = Serialize(MakeGrapheneBlock(scenario)).size();
+
+    scenario.AddCounters(state);
+    state.m_counters["bytes"] = nBytes;
+}
+
+static void GrapheneDecode(benchmark::State &state)
+{
+    const RelayScenario &scenario = GetScenario();
+    std::vector<CDataStream> vEncodings;
+    for (size_t i = 0; i < NUM_ENCODINGS; i++)
+        vEncodings.push_back(Serialize(MakeGrapheneBlock(scenario)));
+
+    DecodeStats stats;
+    while (state.KeepRunning())
+        stats.Add(DecodeGraphene(scenario, vEncodings[stats.nDecodes % NUM_ENCODINGS]));
+
+    scenario.AddCounters(state);
+    stats.AddCounters(state);
+}
+
+static void IbltEncode(benchmark::State &state)
+{
+    const RelayScenario &scenario = GetScenario();
+
+    size_t nBytes = 0;
+    uint32_t nSalt = 0;
+    while (state.KeepRunning())
+        nBytes = Serialize(BlockIblt(scenario, nSalt++)).size();
+
+    scenario.AddCounters(state);
+    state.m_counters["bytes"] = nBytes;
+}
+
+static void IbltDecode(benchmark::State &state)
+{
+    const RelayScenario &scenario = GetScenario();
+    std::vector<CDataStream> vEncodings;
+    for (size_t i = 0; i < NUM_ENCODINGS; i++)
+        vEncodings.push_back(Serialize(BlockIblt(scenario, i)));
+
+    DecodeStats stats;
+    while (state.KeepRunning())
+        stats.Add(DecodeIblt(scenario, vEncodings[stats.nDecodes % NUM_ENCODINGS]));
+
+    scenario.AddCounters(state);
+    stats.AddCounters(state);
+}
+
+BENCHMARK(XThinEncode, 2000);
+BENCHMARK(XThinDecode, 500);
+BENCHMARK(CompactEncode, 200);
+BENCHMARK(CompactDecode, 100);
+BENCHMARK(GrapheneEncode, 200);
+BENCHMARK(GrapheneDecode, 200);
+BENCHMARK(IbltEncode, 2000);
+BENCHMARK(IbltDecode, 1000);
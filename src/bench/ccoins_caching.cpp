@@ -5,6 +5,7 @@
 #include "bench.h"
 #include "coins.h"
 #include "policy/policy.h"
+#include "random.h"
 #include "wallet/crypter.h"
 
 #include <vector>
@@ -90,3 +91,77 @@ static void CCoinsCaching(benchmark::State &state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+/** A pay to public key hash coin, the most common kind in the UTXO set */
+static Coin MakeP2PKHCoin(FastRandomContext &rng)
+{
+    CScript script = GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(20, rng.randbits(8)))));
+    return Coin(CTxOut(rng.randrange(1000 * CENT), script), 1 + rng.randrange(600000), false);
+}
+
+// Fill a coins cache from scratch.  The first run also reports the memory used per coin, which is what decides
+// how many coins fit in a given dbcache.
+static void CCoinsMapInsert(benchmark::State &state)
+{
+    const size_t NUM_COINS = 100000;
+    FastRandomContext rng(true);
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(NUM_COINS);
+    for (size_t i = 0; i < NUM_COINS; i++)
+        outpoints.emplace_back(rng.rand256(), rng.randrange(4));
+    Coin coin = MakeP2PKHCoin(rng);
+
+    bool fReported = false;
+    while (state.KeepRunning())
+    {
+        CCoinsMap map;
+        for (const COutPoint &outpoint : outpoints)
+            map.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(Coin(coin)));
+        if (!fReported)
+        {
+            size_t usage = memusage::DynamicUsage(map);
+            for (const auto &entry : map)
+                usage += entry.second.coin.DynamicMemoryUsage();
+            state.m_counters["bytespercoin"] = (double)usage / map.size();
+            fReported = true;
+        }
+    }
+}
+
+// Random lookups in a coins cache too large for the CPU caches, like the lookups of ConnectBlock
+static void CCoinsMapLookup(benchmark::State &state)
+{
+    const size_t NUM_COINS = 1000000;
+    const size_t LOOKUPS_PER_ITERATION = 1000;
+    FastRandomContext rng(true);
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(NUM_COINS);
+    CCoinsMap map;
+    for (size_t i = 0; i < NUM_COINS; i++)
+    {
+        outpoints.emplace_back(rng.rand256(), rng.randrange(4));
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(outpoints.back()),
+            std::forward_as_tuple(MakeP2PKHCoin(rng)));
+    }
+
+    size_t n = 0;
+    CAmount total = 0;
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < LOOKUPS_PER_ITERATION; i++)
+        {
+            // Half of the lookups are for coins that are not in the cache, as when a block creates and spends
+            // new coins
+            COutPoint outpoint = outpoints[rng.randrange(NUM_COINS)];
+            if (n++ & 1)
+                outpoint.n += 4;
+            CCoinsMap::const_iterator it = map.find(outpoint);
+            if (it != map.end())
+                total += it->second.coin.out.nValue;
+        }
+    }
+    assert(total >= 0);
+}
+
+BENCHMARK(CCoinsMapInsert, 50);
+BENCHMARK(CCoinsMapLookup, 5000);
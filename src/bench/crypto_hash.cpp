@@ -61,6 +61,35 @@ static void SHA256D64_1024(benchmark::State &state)
     }
 }
 
+/* Small batches, as hashed by the merkle tree code near the top of a tree, exercise the 2-way and 8-way paths */
+static void SHA256D64_2(benchmark::State &state)
+{
+    std::vector<uint8_t> in(64 * 2, 0);
+    while (state.KeepRunning())
+    {
+        SHA256D64(in.data(), in.data(), 2);
+    }
+}
+
+static void SHA256D64_8(benchmark::State &state)
+{
+    std::vector<uint8_t> in(64 * 8, 0);
+    while (state.KeepRunning())
+    {
+        SHA256D64(in.data(), in.data(), 8);
+    }
+}
+
+/* Double SHA256 of a block header, as done for proof of work checks */
+static void SHA256D_80b(benchmark::State &state)
+{
+    std::vector<uint8_t> in(80, 0);
+    while (state.KeepRunning())
+    {
+        CHash256().Write(in.data(), in.size()).Finalize(in.data());
+    }
+}
+
 static void SHA512(benchmark::State &state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -107,5 +136,8 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1001 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SHA256D64_2, 2000 * 1000);
+BENCHMARK(SHA256D64_8, 500 * 1000);
+BENCHMARK(SHA256D_80b, 2000 * 1000);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
@@ -0,0 +1,89 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "iblt.h"
+#include "random.h"
+
+#include <set>
+#include <vector>
+
+// A table sized for nDifference keys, as graphene makes them
+static CIblt MakeTable(size_t nDifference) { return CIblt(nDifference, 1, IBLT_MAX_VERSION_SUPPORTED, 0xffff); }
+
+// Fill two tables with nDifference keys that are only in the first, and as many again that are in both, with values of
+// nValueSize bytes
+static void FillTables(size_t nDifference, size_t nValueSize, CIblt &t1, CIblt &t2)
+{
+    FastRandomContext rng(true);
+    for (size_t i = 0; i < 2 * nDifference; i++)
+    {
+        uint64_t k = rng.rand64();
+        std::vector<uint8_t> value(nValueSize);
+        for (uint8_t &byte : value)
+            byte = rng.randbits(8);
+        t1.insert(k, value);
+        if (i % 2)
+            t2.insert(k, value);
+    }
+}
+
+// Inserting the short ids of a large block
+static void IbltInsert10k(benchmark::State &state)
+{
+    FastRandomContext rng(true);
+    std::vector<uint64_t> vKeys(10000);
+    for (uint64_t &k : vKeys)
+        k = rng.rand64();
+
+    const std::vector<uint8_t> value;
+    while (state.KeepRunning())
+    {
+        CIblt t = MakeTable(vKeys.size());
+        for (uint64_t k : vKeys)
+            t.insert(k, value);
+    }
+    state.m_counters["entries"] = vKeys.size();
+}
+
+// Subtracting the table of the receiver from the one that was sent
+static void IbltSubtract10k(benchmark::State &state)
+{
+    CIblt t1 = MakeTable(10000);
+    CIblt t2 = MakeTable(10000);
+    FillTables(10000, 8, t1, t2);
+    while (state.KeepRunning())
+        CIblt diff = t1 - t2;
+    state.m_counters["entries"] = 10000;
+}
+
+// Peeling all the keys out of the difference of two tables
+static void IbltListEntries(benchmark::State &state, size_t nDifference, size_t nValueSize)
+{
+    CIblt t1 = MakeTable(nDifference);
+    CIblt t2 = MakeTable(nDifference);
+    FillTables(nDifference, nValueSize, t1, t2);
+    const CIblt diff = t1 - t2;
+
+    std::set<std::pair<uint64_t, std::vector<uint8_t> > > positive;
+    std::set<std::pair<uint64_t, std::vector<uint8_t> > > negative;
+    while (state.KeepRunning())
+    {
+        positive.clear();
+        negative.clear();
+        bool fDecoded = diff.listEntries(positive, negative);
+        assert(fDecoded);
+    }
+    state.m_counters["entries"] = positive.size() + negative.size();
+}
+
+static void IbltListEntries1k(benchmark::State &state) { IbltListEntries(state, 1000, 0); }
+static void IbltListEntries10k(benchmark::State &state) { IbltListEntries(state, 10000, 0); }
+static void IbltListEntriesValues10k(benchmark::State &state) { IbltListEntries(state, 10000, 8); }
+
+BENCHMARK(IbltInsert10k, 200);
+BENCHMARK(IbltSubtract10k, 2000);
+BENCHMARK(IbltListEntries1k, 1000);
+BENCHMARK(IbltListEntries10k, 100);
+BENCHMARK(IbltListEntriesValues10k, 100);
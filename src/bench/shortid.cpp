@@ -0,0 +1,95 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "blockrelay/compactblock.h"
+#include "blockrelay/graphene_set.h"
+#include "hashwrapper.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "shortidindex.h"
+
+#include <vector>
+
+// The number of transactions in the blocks of these benchmarks
+static const size_t BLOCK_TXS = 100000;
+
+static std::vector<uint256> RandomHashes(size_t nCount)
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> vHashes(nCount);
+    for (uint256 &hash : vHashes)
+        hash = rng.rand256();
+    return vHashes;
+}
+
+// The short ids of a block, one SipHash at a time
+static void ShortIdsOneByOne100k(benchmark::State &state)
+{
+    std::vector<uint256> vHashes = RandomHashes(BLOCK_TXS);
+    std::vector<uint64_t> vShortIds(vHashes.size());
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < vHashes.size(); i++)
+            vShortIds[i] = SipHashUint256(1, 2, vHashes[i]) & 0xffffffffffffL;
+    }
+}
+
+// The short ids of a block with the batched SipHash, on one thread
+static void ShortIdsBatch100k(benchmark::State &state)
+{
+    std::vector<uint256> vHashes = RandomHashes(BLOCK_TXS);
+    std::vector<uint64_t> vShortIds(vHashes.size());
+    while (state.KeepRunning())
+        SipHashUint256Batch(1, 2, vHashes.data(), vShortIds.data(), vHashes.size());
+}
+
+// The short ids of a block with the batched SipHash, split between threads
+static void ShortIdsParallel100k(benchmark::State &state)
+{
+    std::vector<uint256> vHashes = RandomHashes(BLOCK_TXS);
+    const CShortIdSalt salt(1, 2, 0xffffffffffffL);
+    std::vector<uint64_t> vShortIds(vHashes.size());
+    while (state.KeepRunning())
+        salt.GetShortIDs(vHashes.data(), vHashes.size(), vShortIds.data());
+}
+
+// Building a compact block for a block of which the peer knows every transaction
+static void CompactBlockConstruct100k(benchmark::State &state)
+{
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.resize(1);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    for (size_t i = 1; i < BLOCK_TXS; i++)
+    {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(block.vtx[i - 1]->GetHash(), 0);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+
+    while (state.KeepRunning())
+    {
+        CompactBlock cmpctblock(block);
+        assert(cmpctblock.shorttxids.size() == BLOCK_TXS - 1);
+    }
+}
+
+// Encoding the transactions of a block into a graphene set, for a receiver with twice as many in its mempool
+static void GrapheneSetEncode100k(benchmark::State &state)
+{
+    std::vector<uint256> vHashes = RandomHashes(BLOCK_TXS);
+    while (state.KeepRunning())
+        CGrapheneSet set(2 * BLOCK_TXS, BLOCK_TXS, vHashes, 1, 2, 4, 0, true, false, true);
+}
+
+BENCHMARK(ShortIdsOneByOne100k, 100);
+BENCHMARK(ShortIdsBatch100k, 200);
+BENCHMARK(ShortIdsParallel100k, 400);
+BENCHMARK(CompactBlockConstruct100k, 100);
+BENCHMARK(GrapheneSetEncode100k, 5);
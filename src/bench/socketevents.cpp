@@ -0,0 +1,87 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "compat.h"
+#include "socketevents.h"
+
+#ifndef WIN32
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+// Waits for socket events on nConnections connections, one in nActiveEvery of which has data waiting to be read,
+// the way ThreadSocketHandler does for every loop: add each socket, wait, and look up what each one is ready for.
+// Each connection is one end of a socketpair, and the other end is used to make it active.
+static void SocketEvents(benchmark::State &state, bool fUseSelect, size_t nConnections, size_t nActiveEvery)
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < 2 * nConnections + 64)
+    {
+        limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, 2 * nConnections + 64);
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    CSocketEvents socketEvents(fUseSelect);
+    std::vector<SOCKET> vSockets;
+    std::vector<SOCKET> vPeers;
+    for (size_t i = 0; i < nConnections; i++)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            break;
+        if (!socketEvents.UsesEpoll() && !IsSelectableSocket(fds[1]))
+        {
+            close(fds[0]);
+            close(fds[1]);
+            break;
+        }
+        vSockets.push_back(fds[0]);
+        vPeers.push_back(fds[1]);
+        if (nActiveEvery != 0 && i % nActiveEvery == 0)
+        {
+            // Nothing reads this, so the socket stays ready to receive
+            char ch = 0;
+            if (send(fds[1], &ch, 1, 0) != 1)
+                break;
+        }
+    }
+
+    size_t nReady = 0;
+    while (state.KeepRunning())
+    {
+        for (SOCKET hSocket : vSockets)
+            socketEvents.Add(hSocket, CSocketEvents::RECV);
+        socketEvents.Wait(0);
+        for (SOCKET hSocket : vSockets)
+        {
+            if (socketEvents.Ready(hSocket) & CSocketEvents::RECV)
+                nReady++;
+        }
+    }
+
+    for (SOCKET hSocket : vSockets)
+        close(hSocket);
+    for (SOCKET hSocket : vPeers)
+        close(hSocket);
+}
+
+// select() can only wait on sockets below FD_SETSIZE, which both ends of every socketpair count against
+static void SocketEventsSelectIdle500(benchmark::State &state) { SocketEvents(state, true, 500, 0); }
+static void SocketEventsSelectActive500(benchmark::State &state) { SocketEvents(state, true, 500, 10); }
+static void SocketEventsEpollIdle500(benchmark::State &state) { SocketEvents(state, false, 500, 0); }
+static void SocketEventsEpollActive500(benchmark::State &state) { SocketEvents(state, false, 500, 10); }
+static void SocketEventsEpollIdle2000(benchmark::State &state) { SocketEvents(state, false, 2000, 0); }
+static void SocketEventsEpollActive2000(benchmark::State &state) { SocketEvents(state, false, 2000, 10); }
+
+BENCHMARK(SocketEventsSelectIdle500, 2000);
+BENCHMARK(SocketEventsSelectActive500, 2000);
+BENCHMARK(SocketEventsEpollIdle500, 2000);
+BENCHMARK(SocketEventsEpollActive500, 2000);
+BENCHMARK(SocketEventsEpollIdle2000, 500);
+BENCHMARK(SocketEventsEpollActive2000, 500);
+#endif
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "bench.h"
+#include "arith_uint256.h"
 #include "key.h"
 #if defined(HAVE_CONSENSUS_LIB)
 #include "script/bitcoinconsensus.h"
@@ -13,6 +14,7 @@
 #include "streams.h"
 
 #include <array>
+#include <memory>
 
 // FIXME: Dedup with BuildCreditingTransaction in test/script_tests.cpp.
 static CMutableTransaction BuildCreditingTransaction(const CScript &scriptPubKey)
@@ -121,6 +123,55 @@ static void VerifyNestedIfScript(benchmark::State &state)
         assert(ret);
     }
 }
+// A transaction with many inputs, as found in consolidation transactions
+static CMutableTransaction BuildManyInputTransaction(unsigned int nInputs)
+{
+    CMutableTransaction tx;
+    tx.nVersion = 1;
+    tx.nLockTime = 0;
+    tx.vin.resize(nInputs);
+    for (unsigned int i = 0; i < nInputs; i++)
+    {
+        tx.vin[i].prevout.hash = ArithToUint256(arith_uint256(i + 1));
+        tx.vin[i].prevout.n = i % 4;
+        tx.vin[i].nSequence = CTxIn::SEQUENCE_FINAL;
+    }
+    tx.vout.resize(2);
+    for (auto &txout : tx.vout)
+    {
+        txout.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY
+                                       << OP_CHECKSIG;
+        txout.nValue = 1000;
+    }
+    return tx;
+}
+
+// Compute the signature hash of every input of a 1000 input transaction.  Without the precomputed transaction
+// data every input rehashes all the prevouts, sequences and outputs, which is quadratic in the number of inputs.
+static void SighashManyInputs(benchmark::State &state, bool fPrecompute)
+{
+    const CTransaction tx(BuildManyInputTransaction(1000));
+    const CScript scriptCode = tx.vout[0].scriptPubKey;
+    const uint32_t nHashType = SIGHASH_ALL | SIGHASH_FORKID;
+
+    while (state.KeepRunning())
+    {
+        std::unique_ptr<PrecomputedTransactionData> txdata;
+        if (fPrecompute)
+            txdata.reset(new PrecomputedTransactionData(tx));
+        for (unsigned int i = 0; i < tx.vin.size(); i++)
+        {
+            uint256 sighash = SignatureHash(scriptCode, tx, i, nHashType, 1000, nullptr, txdata.get());
+            assert(!sighash.IsNull());
+        }
+    }
+}
+
+static void SighashManyInputsNoPrecompute(benchmark::State &state) { SighashManyInputs(state, false); }
+static void SighashManyInputsPrecompute(benchmark::State &state) { SighashManyInputs(state, true); }
+
 BENCHMARK(VerifyScriptBench, 6300);
+BENCHMARK(SighashManyInputsNoPrecompute, 2);
+BENCHMARK(SighashManyInputsPrecompute, 50);
 
 BENCHMARK(VerifyNestedIfScript, 100);
@@ -3,11 +3,15 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "blockrelay/blockrelay_common.h"
+#include "blockrelay/compactblock.h"
 #include "blockrelay/graphene.h"
+#include "main.h"
 #include "net.h"
 #include "random.h"
 #include "requestManager.h"
 #include "sync.h"
+#include "txmempool.h"
+#include "txorphanpool.h"
 #include "util.h"
 
 // When a node disconnects it may not be removed from the peer tracking sets immediately and so the size
@@ -387,27 +391,60 @@ std::shared_ptr<CBlockThinRelay> ThinTypeRelay::GetBlockToReconstruct(CNode *pfr
     return nullptr;
 }
 
+// The mempool and orphan pool keep an index of the short ids of each salt they are asked about, which is no
+// longer needed once the block that uses the salt is done with.
+static void ReleaseShortIdSalt(const std::shared_ptr<CBlockThinRelay> &pblock)
+{
+    CShortIdSalt salt;
+    if (pblock->cmpctblock)
+        salt = pblock->cmpctblock->GetShortIdSalt();
+    else if (pblock->grapheneblock)
+        salt = GetShortIdSalt(
+            pblock->grapheneblock->shorttxidk0, pblock->grapheneblock->shorttxidk1, pblock->grapheneblock->version);
+    else
+        return;
+    mempool.ReleaseShortIds(salt);
+    orphanpool.ReleaseShortIds(salt);
+}
+
 void ThinTypeRelay::ClearBlockToReconstruct(NodeId id, const uint256 &hash)
 {
-    LOCK(cs_reconstruct);
-    auto key = mapBlocksReconstruct.find(id);
-    if (key != mapBlocksReconstruct.end())
+    std::shared_ptr<CBlockThinRelay> pblock;
     {
-        key->second.erase(hash);
+        LOCK(cs_reconstruct);
+        auto key = mapBlocksReconstruct.find(id);
+        if (key != mapBlocksReconstruct.end())
+        {
+            auto key_hash = key->second.find(hash);
+            if (key_hash != key->second.end())
+            {
+                pblock = key_hash->second;
+                key->second.erase(key_hash);
+            }
+        }
     }
+    if (pblock)
+        ReleaseShortIdSalt(pblock);
 }
 
 void ThinTypeRelay::ClearAllBlocksToReconstruct(NodeId id)
 {
-    LOCK(cs_reconstruct);
-    auto key = mapBlocksReconstruct.find(id);
-    if (key != mapBlocksReconstruct.end())
+    std::vector<std::shared_ptr<CBlockThinRelay> > vBlocks;
     {
-        // we could just erase the entire id key in the outer map, but then we would have to reallocate
-        // space for that node in the event we get another block from them.
-        // only clearing the inner map will take more memory but less cpu time
-        key->second.clear();
+        LOCK(cs_reconstruct);
+        auto key = mapBlocksReconstruct.find(id);
+        if (key != mapBlocksReconstruct.end())
+        {
+            for (const auto &item : key->second)
+                vBlocks.push_back(item.second);
+            // we could just erase the entire id key in the outer map, but then we would have to reallocate
+            // space for that node in the event we get another block from them.
+            // only clearing the inner map will take more memory but less cpu time
+            key->second.clear();
+        }
     }
+    for (const auto &pblock : vBlocks)
+        ReleaseShortIdSalt(pblock);
 }
 
 void ThinTypeRelay::AddBlockBytes(uint64_t bytes, std::shared_ptr<CBlockThinRelay> pblock)
@@ -422,3 +459,44 @@ void ThinTypeRelay::ClearAllBlockData(CNode *pnode, const uint256 &hash)
     ClearBlockToReconstruct(pnode->GetId(), hash);
     ClearBlockInFlight(pnode->GetId(), hash);
 }
+
+CSerializedNetMsgRef ThinTypeRelay::GetRecentBlockMessage(const uint256 &hash,
+    const CMessageHeader::MessageStartChars &magic)
+{
+    LOCK(cs_blockmsgs);
+    for (const auto &item : vRecentBlockMsgs)
+    {
+        if (item.first == hash && memcmp(item.second->data(), magic, MESSAGE_START_SIZE) == 0)
+            return item.second;
+    }
+    return CSerializedNetMsgRef();
+}
+
+void ThinTypeRelay::AddRecentBlockMessage(const uint256 &hash, const CSerializedNetMsgRef &msg)
+{
+    LOCK(cs_blockmsgs);
+    for (auto &item : vRecentBlockMsgs)
+    {
+        if (item.first == hash)
+        {
+            item.second = msg;
+            return;
+        }
+    }
+    vRecentBlockMsgs.emplace_back(hash, msg);
+    while (vRecentBlockMsgs.size() > MAX_RECENT_BLOCK_MSGS)
+        vRecentBlockMsgs.pop_front();
+}
+
+void ThinTypeRelay::PushBlock(CNode *pfrom, const CBlock &block)
+{
+    const CMessageHeader::MessageStartChars &magic = pfrom->GetMagic(Params());
+    const uint256 hash = block.GetHash();
+    CSerializedNetMsgRef msg = GetRecentBlockMessage(hash, magic);
+    if (!msg)
+    {
+        msg = MakeNetMessage(magic, NetMsgType::BLOCK, block);
+        AddRecentBlockMessage(hash, msg);
+    }
+    pfrom->PushSharedMessage(msg);
+}
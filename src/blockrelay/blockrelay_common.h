@@ -8,6 +8,7 @@
 #include "net.h"
 #include "utiltime.h"
 
+#include <deque>
 #include <set>
 #include <stdint.h>
 
@@ -69,6 +70,11 @@ private:
     // blocks still in flight sent by the sender.
     std::map<NodeId, std::shared_ptr<CGrapheneBlock> > mapGrapheneSentBlocks GUARDED_BY(cs_graphene_sender);
 
+    // The block messages that were sent most recently.  Every peer that asks for a new block is sent the same
+    // serialized message, so the block is serialized and checksummed once however many peers it is relayed to.
+    CCriticalSection cs_blockmsgs;
+    std::deque<std::pair<uint256, CSerializedNetMsgRef> > vRecentBlockMsgs GUARDED_BY(cs_blockmsgs);
+
 public:
     void AddPeers(CNode *pfrom);
     uint32_t GetGraphenePeers() { return nGraphenePeers.load(); }
@@ -105,6 +111,17 @@ public:
 
     // Clear all block data
     void ClearAllBlockData(CNode *pnode, const uint256 &hash);
+
+    // The number of recently sent block messages that are kept for other peers
+    static const size_t MAX_RECENT_BLOCK_MSGS = 2;
+
+    // Accessor methods for the recently sent block messages.  A message is only found if it was built with the
+    // given network magic.
+    CSerializedNetMsgRef GetRecentBlockMessage(const uint256 &hash, const CMessageHeader::MessageStartChars &magic);
+    void AddRecentBlockMessage(const uint256 &hash, const CSerializedNetMsgRef &msg);
+
+    // Send a full block, reusing the message that was sent to other peers if there is one.
+    void PushBlock(CNode *pfrom, const CBlock &block);
 };
 extern ThinTypeRelay thinrelay;
 
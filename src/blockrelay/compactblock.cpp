@@ -44,10 +44,13 @@ static bool ReconstructBlock(CNode *pfrom,
     std::shared_ptr<CBlockThinRelay> pblock);
 
 
+//! The bits of the SipHash of a txid that make its short id
+static const uint64_t SHORTTXID_MASK = 0xffffffffffffL;
+
 uint64_t GetShortID(const uint64_t &shorttxidk0, const uint64_t &shorttxidk1, const uint256 &txhash)
 {
     static_assert(CompactBlock::SHORTTXIDS_LENGTH == 6, "shorttxids calculation assumes 6-byte shorttxids");
-    return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffL;
+    return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & SHORTTXID_MASK;
 }
 
 #define MIN_TRANSACTION_SIZE (::GetSerializeSize(CTransaction(), SER_NETWORK, PROTOCOL_VERSION))
@@ -63,6 +66,8 @@ CompactBlock::CompactBlock(const CBlock &block, const CRollingFastFilter<4 * 102
     //< Index of a prefilled tx is its diff from last index.
     size_t prevIndex = 0;
     prefilledtxn.push_back(PrefilledTransaction{0, *block.vtx[0]});
+    std::vector<uint256> vShortTxHashes;
+    vShortTxHashes.reserve(block.vtx.size() - 1);
     for (size_t i = 1; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *block.vtx[i];
@@ -73,9 +78,11 @@ CompactBlock::CompactBlock(const CBlock &block, const CRollingFastFilter<4 * 102
         }
         else
         {
-            shorttxids.push_back(GetShortID(tx.GetHash()));
+            vShortTxHashes.push_back(tx.GetHash());
         }
     }
+    // Hash all the short ids in one batch, which is much faster for large blocks
+    shorttxids = CShortIdSalt(shorttxidk0, shorttxidk1, SHORTTXID_MASK).GetShortIDs(vShortTxHashes);
 }
 
 void CompactBlock::FillShortTxIDSelector() const
@@ -95,6 +102,8 @@ uint64_t CompactBlock::GetShortID(const uint256 &txhash) const
     return ::GetShortID(shorttxidk0, shorttxidk1, txhash);
 }
 
+CShortIdSalt CompactBlock::GetShortIdSalt() const { return CShortIdSalt(shorttxidk0, shorttxidk1, SHORTTXID_MASK); }
+
 void validateCompactBlock(std::shared_ptr<CompactBlock> cmpctblock)
 {
     if (cmpctblock->header.IsNull() || (cmpctblock->shorttxids.empty() && cmpctblock->prefilledtxn.empty()))
@@ -248,44 +257,42 @@ bool CompactBlock::process(CNode *pfrom, std::shared_ptr<CBlockThinRelay> pblock
         cmpctBlock->vTxHashes.insert(it, iterShortID, shorttxids.end());
     }
 
-    // Create a map of all short tx hashes pointing to their full tx hash counterpart
+    // Find the full tx hashes of the short tx hashes in the block.
     // We need to check all transaction sources (orphan list, mempool, and new (incoming) transactions in this block)
     int missingCount = 0;
     int unnecessaryCount = 0;
-    std::map<uint64_t, uint256> mapPartialTxHash;
-    std::vector<uint256> memPoolHashes;
     std::set<uint64_t> setHashesToRequest;
     unsigned int nWaitingForTxns = cmpctBlock->nWaitingFor;
 
     bool fMerkleRootCorrect = true;
     {
-        {
-            READLOCK(orphanpool.cs_orphanpool);
-            for (auto &mi : orphanpool.mapOrphanTransactions)
-            {
-                uint64_t cheapHash = GetShortID(mi.first);
-                mapPartialTxHash[cheapHash] = mi.first;
-            }
-        }
-        mempool.queryHashes(memPoolHashes);
-        for (uint64_t i = 0; i < memPoolHashes.size(); i++)
-        {
-            uint64_t cheapHash = GetShortID(memPoolHashes[i]);
-            mapPartialTxHash[cheapHash] = memPoolHashes[i];
-        }
-        for (auto &mi : cmpctBlock->mapMissingTx)
-        {
-            uint64_t cheapHash = mi.first;
-            mapPartialTxHash[cheapHash] = mi.second->GetHash();
-        }
+        // The orphan pool and mempool index the short ids of this block's salt the first time it is looked up, and
+        // keep the index until the block is done with, so that looking them up again only costs the size of the block.
+        // Check the orphans first: a transaction that moves into the mempool in between is then still found.
+        const std::vector<uint64_t> &vShortIds = pblock->cmpctblock->vTxHashes;
+        const CShortIdSalt salt = GetShortIdSalt();
+        std::vector<uint256> vOrphanHashes;
+        std::vector<uint256> vMemPoolHashes;
+        orphanpool.FindShortIds(salt, vShortIds, vOrphanHashes);
+        mempool.FindShortIds(salt, vShortIds, vMemPoolHashes);
 
         // Start gathering the full tx hashes. If some are not available then add them to setHashesToRequest.
         uint256 nullhash;
-        for (const uint64_t &cheapHash : pblock->cmpctblock->vTxHashes)
+        for (size_t i = 0; i < vShortIds.size(); i++)
         {
-            if (mapPartialTxHash.find(cheapHash) != mapPartialTxHash.end())
+            const uint64_t &cheapHash = vShortIds[i];
+            std::map<uint64_t, CTransactionRef>::iterator iter = cmpctBlock->mapMissingTx.find(cheapHash);
+            if (iter != cmpctBlock->mapMissingTx.end())
+            {
+                pblock->cmpctblock->vTxHashes256.push_back(iter->second->GetHash());
+            }
+            else if (!vMemPoolHashes[i].IsNull())
             {
-                pblock->cmpctblock->vTxHashes256.push_back(mapPartialTxHash[cheapHash]);
+                pblock->cmpctblock->vTxHashes256.push_back(vMemPoolHashes[i]);
+            }
+            else if (!vOrphanHashes[i].IsNull())
+            {
+                pblock->cmpctblock->vTxHashes256.push_back(vOrphanHashes[i]);
             }
             else
             {
@@ -305,9 +312,6 @@ bool CompactBlock::process(CNode *pfrom, std::shared_ptr<CBlockThinRelay> pblock
             }
         }
 
-        // We don't need this after here.
-        mapPartialTxHash.clear();
-
         // Reconstruct the block if there are no hashes to re-request
         if (setHashesToRequest.empty())
         {
@@ -1076,7 +1080,7 @@ void SendCompactBlock(ConstCBlockRef pblock, CNode *pfrom, const CInv &inv)
         }
         else // send full block
         {
-            pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+            thinrelay.PushBlock(pfrom, *pblock);
             LOG(CMPCT, "Sent regular block instead - compactblock size: %d vs block size: %d , peer: %s\n",
                 compactBlock.GetSize(), nSizeBlock, pfrom->GetLogName());
         }
@@ -11,6 +11,7 @@
 #include "primitives/block.h"
 #include "protocol.h"
 #include "serialize.h"
+#include "shortidindex.h"
 #include "stat.h"
 #include "sync.h"
 #include "uint256.h"
@@ -230,6 +231,8 @@ public:
     bool process(CNode *pfrom, std::shared_ptr<CBlockThinRelay> pblock);
     CInv GetInv() { return CInv(MSG_BLOCK, header.GetHash()); }
     uint64_t GetShortID(const uint256 &txhash) const;
+    //! The salt of the short ids of this block, for looking them up in the mempool and orphan pool
+    CShortIdSalt GetShortIdSalt() const;
 
     size_t BlockTxCount() const { return shorttxids.size() + prefilledtxn.size(); }
     ADD_SERIALIZE_METHODS;
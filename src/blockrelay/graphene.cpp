@@ -23,11 +23,24 @@
 #include "utiltime.h"
 #include "validation/validation.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
 static bool ReconstructBlock(CNode *pfrom,
     std::shared_ptr<CBlockThinRelay> pblock,
     const std::map<uint64_t, CTransactionRef> &mapTxFromPools);
 extern CTweak<uint64_t> grapheneFastFilterCompatibility;
+extern CTweak<uint64_t> grapheneRoundTripCost;
+extern CStatHistory<uint64_t> grapheneModelIbltPadding;
+extern CStatHistory<double> grapheneModelFprScale;
+extern CStatHistory<uint64_t> grapheneModelMissingTxs;
+extern CStatHistory<uint64_t> grapheneModelDecodeFailures;
+extern CStatHistory<uint64_t> grapheneModelRecoveryBytes;
+
+// The bytes that room for one more item takes in an IBLT, which is its share of the cells with a 16 bit checksum
+static const double IBLT_ITEM_BYTES = IBLT_DEFAULT_OVERHEAD * (IBLT_FIXED_CELL_SIZE + 2);
+// The most that the false positive rate of a Bloom filter is divided by for peers at which blocks did not decode
+static const double MAX_BLOOM_FPR_DIVISOR = 64;
 
 CMemPoolInfo::CMemPoolInfo(uint64_t _nTx) : nTx(_nTx) {}
 CMemPoolInfo::CMemPoolInfo() { this->nTx = 0; }
@@ -35,7 +48,8 @@ CGrapheneBlock::CGrapheneBlock(const CBlockRef pblock,
     uint64_t nReceiverMemPoolTx,
     uint64_t nSenderMempoolPlusBlock,
     uint64_t _version,
-    bool _computeOptimized)
+    bool _computeOptimized,
+    const GrapheneSetTuning &tuning)
     : // Use cryptographically strong pseudorandom number because
       // we will extract SipHash secret key from this
       sipHashNonce(GetRand(std::numeric_limits<uint64_t>::max())),
@@ -58,12 +72,13 @@ CGrapheneBlock::CGrapheneBlock(const CBlockRef pblock,
     }
 
     if (fCanonicalTxsOrder)
-        pGrapheneSet =
-            std::make_shared<CGrapheneSet>(CGrapheneSet(nReceiverMemPoolTx, nSenderMempoolPlusBlock, blockHashes,
-                shorttxidk0, shorttxidk1, grapheneSetVersion, (uint32_t)sipHashNonce, computeOptimized, false));
+        pGrapheneSet = std::make_shared<CGrapheneSet>(CGrapheneSet(nReceiverMemPoolTx, nSenderMempoolPlusBlock,
+            blockHashes, shorttxidk0, shorttxidk1, grapheneSetVersion, (uint32_t)sipHashNonce, computeOptimized, false,
+            false, tuning));
     else
         pGrapheneSet = std::make_shared<CGrapheneSet>(CGrapheneSet(nReceiverMemPoolTx, nSenderMempoolPlusBlock,
-            blockHashes, shorttxidk0, shorttxidk1, grapheneSetVersion, (uint32_t)sipHashNonce, computeOptimized, true));
+            blockHashes, shorttxidk0, shorttxidk1, grapheneSetVersion, (uint32_t)sipHashNonce, computeOptimized, true,
+            false, tuning));
     fpr = pGrapheneSet->GetBloomFPR();
 }
 
@@ -349,6 +364,8 @@ bool CRequestGrapheneBlockTx::HandleMessage(CDataStream &vRecv, CNode *pfrom)
     }
 
     LOG(GRAPHENE, "Received get_grblocktx for %s peer=%s\n", blkHash.ToString(), pfrom->GetLogName());
+    graphenedata.UpdatePeerMissingTxs(
+        pfrom->GetId(), blkHash, grapheneRequestBlockTx.setCheapHashesToRequest.size());
 
     try
     {
@@ -493,37 +510,49 @@ bool CGrapheneBlock::HandleMessage(CDataStream &vRecv, CNode *pfrom, std::string
 
 void CGrapheneBlock::FillTxMapFromPools(std::map<uint64_t, CTransactionRef> &mapTxFromPools)
 {
+    const CShortIdSalt salt = GetShortIdSalt(shorttxidk0, shorttxidk1, version);
     {
-        boost::unique_lock<boost::mutex> lock(csCommitQ);
-        for (auto &kv : *txCommitQ)
+        std::vector<uint256> vCommitQHashes;
+        std::vector<CTransactionRef> vCommitQTxs;
         {
-            uint64_t cheapHash = GetShortID(shorttxidk0, shorttxidk1, kv.first, version);
-            auto shTx = kv.second.entry.GetSharedTx();
-            if (shTx != nullptr)
-                mapTxFromPools.insert(std::make_pair(cheapHash, shTx));
+            boost::unique_lock<boost::mutex> lock(csCommitQ);
+            vCommitQHashes.reserve(txCommitQ->size());
+            vCommitQTxs.reserve(txCommitQ->size());
+            for (auto &kv : *txCommitQ)
+            {
+                auto shTx = kv.second.entry.GetSharedTx();
+                if (shTx != nullptr)
+                {
+                    vCommitQHashes.push_back(kv.first);
+                    vCommitQTxs.push_back(shTx);
+                }
+            }
         }
+        std::vector<uint64_t> vCheapHashes = salt.GetShortIDs(vCommitQHashes);
+        for (size_t i = 0; i < vCheapHashes.size(); i++)
+            mapTxFromPools.insert(std::make_pair(vCheapHashes[i], vCommitQTxs[i]));
     }
 
+    // The orphan pool and mempool index the short ids of a salt the first time it is used and keep them until the
+    // block is done with, so the recovery rounds of this block do not hash the pools again
+    std::vector<std::pair<uint64_t, uint256> > vShortIds;
+    orphanpool.QueryShortIds(salt, vShortIds);
     {
         READLOCK(orphanpool.cs_orphanpool);
-        for (auto &kv : orphanpool.mapOrphanTransactions)
+        for (const auto &item : vShortIds)
         {
-            uint64_t cheapHash = GetShortID(shorttxidk0, shorttxidk1, kv.first, version);
-            auto shTx = kv.second.ptx;
-            if (shTx != nullptr)
-                mapTxFromPools.insert(std::make_pair(cheapHash, shTx));
+            auto iter = orphanpool.mapOrphanTransactions.find(item.second);
+            if (iter != orphanpool.mapOrphanTransactions.end() && iter->second.ptx != nullptr)
+                mapTxFromPools.insert(std::make_pair(item.first, iter->second.ptx));
         }
     }
 
-    std::vector<uint256> memPoolHashes;
-    mempool.queryHashes(memPoolHashes);
-
-    for (const uint256 &hash : memPoolHashes)
+    mempool.queryShortIds(salt, vShortIds);
+    for (const auto &item : vShortIds)
     {
-        uint64_t cheapHash = GetShortID(shorttxidk0, shorttxidk1, hash, version);
-        auto shTx = mempool.get(hash);
+        auto shTx = mempool.get(item.second);
         if (shTx != nullptr) // otherwise mempool got updated between the query and this iteration
-            mapTxFromPools.insert(std::make_pair(cheapHash, shTx));
+            mapTxFromPools.insert(std::make_pair(item.first, shTx));
     }
 }
 
@@ -1074,6 +1103,140 @@ void CGrapheneBlockData::UpdateInBoundReRequestedTx(int nReRequestedTx)
     updateStats(mapGrapheneBlocksInBoundReRequestedTx, nReRequestedTx);
 }
 
+void CGrapheneBlockData::finishPeerBlock(CGraphenePeerModel &model) EXCLUSIVE_LOCKS_REQUIRED(cs_graphenestats)
+{
+    AssertLockHeld(cs_graphenestats);
+    if (model.lastBlockHash.IsNull())
+        return;
+
+    // Missing transactions that a block which decoded anyway had, or that the baseline IBLT had room for, say
+    // nothing about how much room to add
+    uint64_t nExcessTxs = 0;
+    if (model.fLastFailed && model.nLastMissingTxs > model.nLastBaselineIbltItems)
+        nExcessTxs = model.nLastMissingTxs - model.nLastBaselineIbltItems;
+    model.vFailedExcessRates.push_back(model.nLastBlockTxs ? (double)nExcessTxs / model.nLastBlockTxs : 0.0);
+    if (model.vFailedExcessRates.size() > GRAPHENE_PEER_HISTORY)
+        model.vFailedExcessRates.pop_front();
+
+    // A block without more missing transactions than the IBLT was given room for should have decoded
+    bool fOtherFailure = model.fLastFailed && nExcessTxs <= model.lastTuning.nExtraIbltItems;
+    model.dOtherFailureRate += ((fOtherFailure ? 1.0 : 0.0) - model.dOtherFailureRate) / GRAPHENE_PEER_HISTORY;
+
+    grapheneModelMissingTxs << model.nLastMissingTxs;
+    model.lastBlockHash.SetNull();
+}
+
+GrapheneSetTuning CGrapheneBlockData::GetPeerTuning(NodeId id, uint64_t nBlockTxs)
+{
+    double dRoundTripCost = grapheneRoundTripCost.Value();
+    if (dRoundTripCost == 0 || nBlockTxs == 0)
+        return GrapheneSetTuning();
+
+    LOCK(cs_graphenestats);
+    auto it = mapPeerModels.find(id);
+    if (it == mapPeerModels.end())
+        return GrapheneSetTuning();
+    const CGraphenePeerModel &model = it->second;
+    double dFailureCost = dRoundTripCost + dRecoveryBytes;
+
+    // The IBLT runs out of room for a block that is missing more transactions than it was given room for, which
+    // is as often as the recent blocks failed to decode with less room than that, counting the next one as one that
+    // does not.
+    std::vector<uint64_t> vExcessTxs;
+    for (double dExcessRate : model.vFailedExcessRates)
+        vExcessTxs.push_back(std::ceil(dExcessRate * nBlockTxs));
+    auto failureRate = [&vExcessTxs](uint64_t nExtraIbltItems) {
+        size_t nFailures = std::count_if(vExcessTxs.begin(), vExcessTxs.end(),
+            [nExtraIbltItems](uint64_t nExcessTxs) { return nExcessTxs > nExtraIbltItems; });
+        return (double)nFailures / (vExcessTxs.size() + 1);
+    };
+
+    GrapheneSetTuning tuning;
+    double dBestCost = failureRate(0) * dFailureCost;
+    for (uint64_t nExtraIbltItems : vExcessTxs)
+    {
+        double dCost = nExtraIbltItems * IBLT_ITEM_BYTES + failureRate(nExtraIbltItems) * dFailureCost;
+        if (dCost < dBestCost)
+        {
+            dBestCost = dCost;
+            tuning.nExtraIbltItems = nExtraIbltItems;
+        }
+    }
+
+    // Other failures are taken to be from more false positives than the IBLT had room for, which a Bloom filter
+    // with a false positive rate d times lower makes d times less likely, for log2(d) / ln(2) more bits per item.
+    dBestCost = model.dOtherFailureRate * dFailureCost;
+    for (double d = 2; d <= MAX_BLOOM_FPR_DIVISOR; d *= 2)
+    {
+        double dCost = nBlockTxs * std::log2(d) / (8 * M_LN2) + model.dOtherFailureRate / d * dFailureCost;
+        if (dCost < dBestCost)
+        {
+            dBestCost = dCost;
+            tuning.bloomFprScale = 1 / d;
+        }
+    }
+
+    return tuning;
+}
+
+void CGrapheneBlockData::UpdatePeerBlockSent(NodeId id,
+    const uint256 &blockhash,
+    uint64_t nBlockTxs,
+    uint64_t nBaselineIbltItems,
+    const GrapheneSetTuning &tuning)
+{
+    LOCK(cs_graphenestats);
+    CGraphenePeerModel &model = mapPeerModels[id];
+    finishPeerBlock(model);
+
+    model.lastBlockHash = blockhash;
+    model.nLastBlockTxs = nBlockTxs;
+    model.nLastBaselineIbltItems = nBaselineIbltItems;
+    model.lastTuning = tuning;
+    model.nLastMissingTxs = 0;
+    model.fLastFailed = false;
+    model.nBlocks += 1;
+
+    grapheneModelIbltPadding << tuning.nExtraIbltItems;
+    grapheneModelFprScale << tuning.bloomFprScale;
+}
+
+void CGrapheneBlockData::UpdatePeerMissingTxs(NodeId id, const uint256 &blockhash, uint64_t nMissingTxs)
+{
+    LOCK(cs_graphenestats);
+    auto it = mapPeerModels.find(id);
+    if (it != mapPeerModels.end() && it->second.lastBlockHash == blockhash)
+        it->second.nLastMissingTxs += nMissingTxs;
+}
+
+void CGrapheneBlockData::UpdatePeerDecodeFailure(NodeId id, const uint256 &blockhash)
+{
+    LOCK(cs_graphenestats);
+    auto it = mapPeerModels.find(id);
+    if (it == mapPeerModels.end() || it->second.lastBlockHash != blockhash || it->second.fLastFailed)
+        return;
+
+    it->second.fLastFailed = true;
+    it->second.nDecodeFailures += 1;
+    grapheneModelDecodeFailures += 1;
+}
+
+void CGrapheneBlockData::UpdateRecoveryBytes(uint64_t nRecoveryBytes)
+{
+    LOCK(cs_graphenestats);
+    if (dRecoveryBytes == 0)
+        dRecoveryBytes = nRecoveryBytes;
+    else
+        dRecoveryBytes += (nRecoveryBytes - dRecoveryBytes) / GRAPHENE_PEER_HISTORY;
+    grapheneModelRecoveryBytes << nRecoveryBytes;
+}
+
+void CGrapheneBlockData::RemovePeer(NodeId id)
+{
+    LOCK(cs_graphenestats);
+    mapPeerModels.erase(id);
+}
+
 std::string CGrapheneBlockData::ToString()
 {
     LOCK(cs_graphenestats);
@@ -1334,8 +1497,9 @@ void SendGrapheneBlock(CBlockRef pblock, CNode *pfrom, const CInv &inv, const CM
             uint64_t nSenderMempoolPlusBlock =
                 GetGrapheneMempoolInfo().nTx + pblock->vtx.size() - 1; // exclude coinbase
 
+            GrapheneSetTuning tuning = graphenedata.GetPeerTuning(pfrom->GetId(), pblock->vtx.size());
             CGrapheneBlock grapheneBlock(pblock, mempoolinfo.nTx, nSenderMempoolPlusBlock,
-                NegotiateGrapheneVersion(pfrom), NegotiateFastFilterSupport(pfrom));
+                NegotiateGrapheneVersion(pfrom), NegotiateFastFilterSupport(pfrom), tuning);
 
             LOG(GRAPHENE, "Block %s to peer %s using Graphene version %d\n", grapheneBlock.header.GetHash().ToString(),
                 pfrom->GetLogName(), grapheneBlock.version);
@@ -1348,7 +1512,7 @@ void SendGrapheneBlock(CBlockRef pblock, CNode *pfrom, const CInv &inv, const CM
             // If graphene block is larger than a regular block then send a regular block instead
             if (nSizeGrapheneBlock > nSizeBlock)
             {
-                pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+                thinrelay.PushBlock(pfrom, *pblock);
                 LOG(GRAPHENE, "Sent regular block instead - graphene block size: %d vs block size: %d => peer: %s\n",
                     nSizeGrapheneBlock, nSizeBlock, pfrom->GetLogName());
             }
@@ -1364,6 +1528,8 @@ void SendGrapheneBlock(CBlockRef pblock, CNode *pfrom, const CInv &inv, const CM
                 }
                 // Next store graphene block in case receiver attempts failure recovery
                 thinrelay.SetSentGrapheneBlocks(pfrom->GetId(), grapheneBlock);
+                graphenedata.UpdatePeerBlockSent(pfrom->GetId(), grapheneBlock.header.GetHash(), pblock->vtx.size(),
+                    grapheneBlock.pGrapheneSet->GetBaselineIbltItems(), tuning);
                 LOG(GRAPHENE, "Sent graphene block - size: %d vs block size: %d => peer: %s\n", nSizeGrapheneBlock,
                     nSizeBlock, pfrom->GetLogName());
 
@@ -1376,7 +1542,7 @@ void SendGrapheneBlock(CBlockRef pblock, CNode *pfrom, const CInv &inv, const CM
         }
         catch (const std::runtime_error &e)
         {
-            pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+            thinrelay.PushBlock(pfrom, *pblock);
             LOG(GRAPHENE,
                 "Sent regular block instead - encountered error when creating graphene block for peer %s: %s\n",
                 pfrom->GetLogName(), e.what());
@@ -1455,10 +1621,13 @@ bool HandleGrapheneBlockRecoveryRequest(CDataStream &vRecv, CNode *pfrom, const
     // We had a block stored but it was the wrong one
     if (grapheneBlock->header.GetHash() != recoveryRequest.blockhash)
         return error("Sender does not have block for requested hash");
+    graphenedata.UpdatePeerDecodeFailure(pfrom->GetId(), recoveryRequest.blockhash);
 
     CGrapheneReceiverRecover recoveryResponse = CGrapheneReceiverRecover(
         *recoveryRequest.pReceiverFilter, *grapheneBlock, recoveryRequest.nSenderFilterPositives, pfrom);
     pfrom->PushMessage(NetMsgType::GRAPHENE_RECOVERY, recoveryResponse);
+    graphenedata.UpdateRecoveryBytes(::GetSerializeSize(recoveryRequest, SER_NETWORK, PROTOCOL_VERSION) +
+                                     ::GetSerializeSize(recoveryResponse, SER_NETWORK, PROTOCOL_VERSION));
 
     return true;
 }
@@ -1753,6 +1922,13 @@ uint64_t GetShortID(uint64_t shorttxidk0, uint64_t shorttxidk1, const uint256 &t
     return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffffL;
 }
 
+CShortIdSalt GetShortIdSalt(uint64_t shorttxidk0, uint64_t shorttxidk1, uint64_t grapheneVersion)
+{
+    if (grapheneVersion < 2)
+        return CShortIdSalt();
+    return CShortIdSalt(shorttxidk0, shorttxidk1, 0xffffffffffffffL);
+}
+
 bool NegotiateFastFilterSupport(CNode *pfrom)
 {
     uint64_t peerFastFilterPref;
@@ -15,12 +15,14 @@
 #include "primitives/block.h"
 #include "protocol.h"
 #include "serialize.h"
+#include "shortidindex.h"
 #include "stat.h"
 #include "sync.h"
 #include "uint256.h"
 #include "unlimited.h"
 
 #include <atomic>
+#include <deque>
 #include <vector>
 
 enum FastFilterSupport
@@ -36,6 +38,10 @@ const uint64_t GRAPHENE_MAX_VERSION_SUPPORTED = 6;
 const unsigned char MIN_MEMPOOL_INFO_BYTES = 8;
 const uint8_t SHORTTXIDS_LENGTH = 8;
 const double FAILURE_RECOVERY_SUCCESS_RATE = 0.999;
+// The number of blocks sent to a peer from whose decoding the next blocks for that peer are sized
+const size_t GRAPHENE_PEER_HISTORY = 32;
+// The default cost in bytes of the round trip to recover from a graphene block that did not decode
+const uint64_t DEFAULT_GRAPHENE_ROUND_TRIP_COST = 50000;
 
 class CDataStream;
 class CNode;
@@ -95,7 +101,8 @@ public:
         uint64_t nReceiverMemPoolTx,
         uint64_t nSenderMempoolPlusBlock,
         uint64_t _version,
-        bool _computeOptimized);
+        bool _computeOptimized,
+        const GrapheneSetTuning &tuning = GrapheneSetTuning());
     CGrapheneBlock()
         : nSize(0), nWaitingFor(0), shorttxidk0(0), shorttxidk1(0), pGrapheneSet(nullptr), version(2),
           computeOptimized(false)
@@ -297,6 +304,27 @@ struct GrapheneQuickStats
     }
 };
 
+// What the sender of graphene blocks to a peer has seen of how they decoded
+struct CGraphenePeerModel
+{
+    // For each recent block that did not decode, oldest first, the fraction of its transactions by which the ones the
+    // peer did not have exceeded the room the IBLT was sized for before tuning; 0 for the blocks that decoded
+    std::deque<double> vFailedExcessRates;
+    // How often recent blocks did not decode for reasons other than the transactions the peer did not have
+    double dOtherFailureRate = 0.0;
+    uint64_t nBlocks = 0;
+    uint64_t nDecodeFailures = 0;
+
+    // The last block sent, which goes into the history above when the next one is sent, by when the peer has asked for
+    // the transactions it did not have or recovered from a failure to decode it
+    uint256 lastBlockHash;
+    uint64_t nLastBlockTxs = 0;
+    uint64_t nLastBaselineIbltItems = 0;
+    GrapheneSetTuning lastTuning;
+    uint64_t nLastMissingTxs = 0;
+    bool fLastFailed = false;
+};
+
 // This class stores statistics for graphene block derived protocols.
 class CGrapheneBlockData
 {
@@ -326,6 +354,14 @@ private:
     std::map<int64_t, double> mapGrapheneBlockResponseTime;
     std::map<int64_t, double> mapGrapheneBlockValidationTime;
     std::map<int64_t, int> mapGrapheneBlocksInBoundReRequestedTx;
+    std::map<NodeId, CGraphenePeerModel> mapPeerModels;
+    // Average size in bytes of the messages of a failure recovery
+    double dRecoveryBytes = 0.0;
+
+    /**
+      Add the last block sent to a peer to the history of its model.
+      Requires lock on cs_graphenestats be held external to this call. */
+    void finishPeerBlock(CGraphenePeerModel &model) EXCLUSIVE_LOCKS_REQUIRED(cs_graphenestats);
 
     /**
         Add new entry to statistics array; also removes old timestamps
@@ -391,6 +427,29 @@ public:
     void UpdateResponseTime(double nResponseTime);
     void UpdateValidationTime(double nValidationTime);
     void UpdateInBoundReRequestedTx(int nReRequestedTx);
+
+    /**
+      Choose how to change the sizes of the next graphene block sent to a peer, from how the earlier ones decoded.
+
+      The IBLT is already sized for the transactions the peer is expected not to have, so it only gets room for as
+      many more as a recent block that did not decode exceeded that by.  The Bloom filter gets a false positive rate
+      up to 64 times lower to make up for failures that those transactions do not explain.  Of these, the change with
+      the least bytes added plus expected cost of a failure recovery is chosen, where the expected cost comes from how
+      many of the recent blocks that did not decode would still have failed with it.
+
+      @param [id] the peer the block is for
+      @param [nBlockTxs] the number of transactions in the block
+     */
+    GrapheneSetTuning GetPeerTuning(NodeId id, uint64_t nBlockTxs);
+    void UpdatePeerBlockSent(NodeId id,
+        const uint256 &blockhash,
+        uint64_t nBlockTxs,
+        uint64_t nBaselineIbltItems,
+        const GrapheneSetTuning &tuning);
+    void UpdatePeerMissingTxs(NodeId id, const uint256 &blockhash, uint64_t nMissingTxs);
+    void UpdatePeerDecodeFailure(NodeId id, const uint256 &blockhash);
+    void UpdateRecoveryBytes(uint64_t nRecoveryBytes);
+    void RemovePeer(NodeId id);
     std::string ToString();
     std::string InBoundPercentToString();
     std::string OutBoundPercentToString();
@@ -511,6 +570,8 @@ std::vector<CTransaction> TransactionsFromBlockByCheapHash(std::set<uint64_t> &v
     CNode *pfrom);
 // Generate cheap hash from seeds using SipHash
 uint64_t GetShortID(uint64_t shorttxidk0, uint64_t shorttxidk1, const uint256 &txhash, uint64_t grapheneVersion);
+// The salt that GetShortID uses, for looking up short ids in the mempool and orphan pool
+CShortIdSalt GetShortIdSalt(uint64_t shorttxidk0, uint64_t shorttxidk1, uint64_t grapheneVersion);
 // This method decides on the value of computeOptimized depending on what modes are supported
 // by both the sender and receiver
 bool NegotiateFastFilterSupport(CNode *pfrom);
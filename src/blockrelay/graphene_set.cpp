@@ -27,7 +27,8 @@ CGrapheneSet::CGrapheneSet(size_t _nReceiverUniverseItems,
     uint32_t ibltEntropy,
     bool _computeOptimized,
     bool _ordered,
-    bool fDeterministic)
+    bool fDeterministic,
+    const GrapheneSetTuning &tuning)
     : ordered(_ordered), nReceiverUniverseItems(_nReceiverUniverseItems), shorttxidk0(_shorttxidk0),
       shorttxidk1(_shorttxidk1), version(_version), ibltSalt(ibltEntropy), computeOptimized(_computeOptimized),
       pSetFilter(nullptr), pFastFilter(nullptr), pSetIblt(nullptr), bloomFPR(1.0)
@@ -39,8 +40,9 @@ CGrapheneSet::CGrapheneSet(size_t _nReceiverUniverseItems,
 
     GrapheneSetOptimizationParams params =
         DetermineGrapheneSetOptimizationParams(nReceiverUniverseItems, nSenderUniverseItems, nItems, version);
-    double optSymDiff = params.optSymDiff;
-    bloomFPR = params.bloomFPR;
+    nBaselineIbltItems = std::ceil(params.optSymDiff);
+    double optSymDiff = params.optSymDiff + tuning.nExtraIbltItems;
+    bloomFPR = params.bloomFPR * tuning.bloomFprScale;
 
     // For testing stage 2, allow FPR to be set to specific value
     if (grapheneBloomFprOverride.Value() > 0.0)
@@ -65,9 +67,11 @@ CGrapheneSet::CGrapheneSet(size_t _nReceiverUniverseItems,
 
     std::map<uint64_t, uint256> mapCheapHashes;
 
-    for (const uint256 &itemHash : _itemHashes)
+    std::vector<uint64_t> vCheapHashes = GetShortIDs(_itemHashes);
+    for (size_t i = 0; i < _itemHashes.size(); i++)
     {
-        uint64_t cheapHash = GetShortID(itemHash);
+        const uint256 &itemHash = _itemHashes[i];
+        uint64_t cheapHash = vCheapHashes[i];
 
         if (computeOptimized)
         {
@@ -115,6 +119,14 @@ uint64_t CGrapheneSet::GetShortID(const uint256 &txhash) const
     return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffffL;
 }
 
+std::vector<uint64_t> CGrapheneSet::GetShortIDs(const std::vector<uint256> &txhashes) const
+{
+    if (version == 0)
+        return CShortIdSalt().GetShortIDs(txhashes);
+
+    return CShortIdSalt(shorttxidk0, shorttxidk1, 0xffffffffffffffL).GetShortIDs(txhashes);
+}
+
 
 double CGrapheneSet::OptimalSymDiff(uint64_t version,
     uint64_t nBlockTxs,
@@ -244,9 +256,11 @@ std::vector<uint64_t> CGrapheneSet::Reconcile(const std::vector<uint256> &receiv
     localIblt.reset();
 
     int passedFilter = 0;
-    for (const uint256 &itemHash : receiverItemHashes)
+    std::vector<uint64_t> vCheapHashes = GetShortIDs(receiverItemHashes);
+    for (size_t i = 0; i < receiverItemHashes.size(); i++)
     {
-        uint64_t cheapHash = GetShortID(itemHash);
+        const uint256 &itemHash = receiverItemHashes[i];
+        uint64_t cheapHash = vCheapHashes[i];
 
         auto ir = mapCheapHashes.insert(std::make_pair(cheapHash, itemHash));
         if (!ir.second)
@@ -11,6 +11,7 @@
 #include "iblt.h"
 #include "random.h"
 #include "serialize.h"
+#include "shortidindex.h"
 #include "uint256.h"
 #include "util.h"
 
@@ -43,6 +44,20 @@ struct GrapheneSetOptimizationParams
     double bloomFPR;
 };
 
+// Changes to the optimal sizes of a graphene set, for a receiver at which earlier sets did not decode as expected
+struct GrapheneSetTuning
+{
+    // Room in the IBLT for this many more items
+    uint64_t nExtraIbltItems;
+    // Factor applied to the false positive rate of the Bloom filter
+    double bloomFprScale;
+
+    GrapheneSetTuning(uint64_t _nExtraIbltItems = 0, double _bloomFprScale = 1.0)
+        : nExtraIbltItems(_nExtraIbltItems), bloomFprScale(_bloomFprScale)
+    {
+    }
+};
+
 class CGrapheneSet
 {
 private:
@@ -57,6 +72,8 @@ private:
     std::shared_ptr<CVariableFastFilter> pFastFilter;
     std::shared_ptr<CIblt> pSetIblt;
     double bloomFPR;
+    // The number of items the IBLT was sized for before any tuning.  Only known to the sender.
+    uint64_t nBaselineIbltItems = 0;
 
     static const uint8_t SHORTTXIDS_LENGTH = 8;
 
@@ -97,10 +114,13 @@ public:
         uint32_t ibltEntropy = 0,
         bool _computeOptimized = false,
         bool _ordered = false,
-        bool fDeterministic = false);
+        bool fDeterministic = false,
+        const GrapheneSetTuning &tuning = GrapheneSetTuning());
 
     // Generate cheap hash from seeds using SipHash
     uint64_t GetShortID(const uint256 &txhash) const;
+    // Generate the cheap hashes of many items at once, which is faster than one at a time
+    std::vector<uint64_t> GetShortIDs(const std::vector<uint256> &txhashes) const;
     // The ordinality of all possible items that could appear in this set
     uint64_t GetNReceiverUniverseItems() const { return nReceiverUniverseItems; }
     // It false items are returned in arbitrary order
@@ -109,6 +129,8 @@ public:
     bool GetComputeOptimized() const { return computeOptimized; }
     // Return the false positive rate for this set's bloom filter
     double GetBloomFPR() const { return bloomFPR; }
+    // The number of items the IBLT was sized for before the tuning was applied
+    uint64_t GetBaselineIbltItems() const { return nBaselineIbltItems; }
     std::vector<unsigned char> GetEncodedRank() const { return encodedRank; }
     std::shared_ptr<CIblt> GetIblt() const { return pSetIblt; }
     std::shared_ptr<CBloomFilter> GetRegularFilter() const { return pSetFilter; }
@@ -612,97 +612,76 @@ bool CXThinBlock::process(CNode *pfrom, std::string strCommand, std::shared_ptr<
     for (const CTransaction &tx : vMissingTx)
         thinBlock->mapMissingTx[tx.GetHash().GetCheapHash()] = MakeTransactionRef(tx);
 
-    // Create a map of all 8 bytes tx hashes pointing to their full tx hash counterpart
+    // Find the full tx hashes of the 8 bytes tx hashes in the block.
     // We need to check all transaction sources (orphan list, mempool, and new (incoming) transactions in this block)
     // for a collision.
     int missingCount = 0;
     int unnecessaryCount = 0;
     bool _collision = false;
-    std::map<uint64_t, uint256> mapPartialTxHash;
-    std::vector<uint256> memPoolHashes;
     std::set<uint64_t> setHashesToRequest;
     unsigned int &nWaitingForTxns = thinBlock->nWaitingFor;
     std::vector<uint256> &vFullTxHashes = thinBlock->vTxHashes256;
 
     bool fMerkleRootCorrect = true;
     {
-        // Do the orphans first before taking the mempool.cs lock, so that we maintain correct locking order.
+        // The cheap hashes of the orphan pool and mempool are indexed, so only the cheap hashes in the block are
+        // looked up, and only those can collide.
         //
-        // We must keep the orphanpool lock during the period that we check the mempool hashes to prevent
-        // us from seeing a hash in the orphan pool that may have gotten into the mempool just after we
-        // released the orphan lock and before we took the mempool lock, which would show up as a false hash
-        // collision.
+        // Do the orphans first, so that a transaction that gets into the mempool just after we looked in the
+        // orphan pool and before we look in the mempool is still found.
+        const CShortIdSalt salt;
+        std::vector<uint256> vOrphanHashes;
+        std::vector<uint256> vMemPoolHashes;
+        if (orphanpool.FindShortIds(salt, vTxHashes, vOrphanHashes) > 0)
+            _collision = true;
+        if (mempool.FindShortIds(salt, vTxHashes, vMemPoolHashes) > 0)
+            _collision = true;
+
+        // Start gathering the full tx hashes. If some are not available then add them to setHashesToRequest.
+        uint256 nullhash;
+        for (size_t i = 0; i < vTxHashes.size(); i++)
         {
-            READLOCK(orphanpool.cs_orphanpool);
-            for (auto &mi : orphanpool.mapOrphanTransactions)
+            const uint64_t &cheapHash = vTxHashes[i];
+            uint256 hash;
+            std::map<uint64_t, CTransactionRef>::iterator iter = thinBlock->mapMissingTx.find(cheapHash);
+            if (iter != thinBlock->mapMissingTx.end())
+                hash = iter->second->GetHash();
+            for (const uint256 &poolHash : {vMemPoolHashes[i], vOrphanHashes[i]})
             {
-                uint64_t cheapHash = mi.first.GetCheapHash();
-                if (mapPartialTxHash.count(cheapHash)) // Check for collisions
+                if (poolHash.IsNull())
+                    continue;
+                // Only mark as collision if the full hash is not the same, because the same tx could have been
+                // received into the mempool during the request of the xthinblock, or be moving from the orphan pool
+                // into the mempool. In that case we would have the same transaction twice, so it is not a real
+                // cheap hash collision and we continue normally.
+                if (hash.IsNull())
+                    hash = poolHash;
+                else if (hash != poolHash)
                     _collision = true;
-                mapPartialTxHash[cheapHash] = mi.first;
             }
 
-            mempool.queryHashes(memPoolHashes);
-            for (uint64_t i = 0; i < memPoolHashes.size(); i++)
-            {
-                uint64_t cheapHash = memPoolHashes[i].GetCheapHash();
-                if (mapPartialTxHash.count(cheapHash)) // Check for collisions
-                    _collision = true;
-                mapPartialTxHash[cheapHash] = memPoolHashes[i];
-            }
-        }
-        for (auto &mi : thinBlock->mapMissingTx)
-        {
-            uint64_t cheapHash = mi.first;
-            // Check for cheap hash collision. Only mark as collision if the full hash is not the same,
-            // because the same tx could have been received into the mempool during the request of the xthinblock.
-            // In that case we would have the same transaction twice, so it is not a real cheap hash collision and we
-            // continue normally.
-            const uint256 existingHash = mapPartialTxHash[cheapHash];
-            // Check if we already have the cheap hash
-            if (!existingHash.IsNull())
+            if (!hash.IsNull())
+                vFullTxHashes.push_back(hash);
+            else
             {
-                // Check if it really is a cheap hash collision and not just the same transaction
-                if (existingHash != mi.second->GetHash())
-                {
-                    _collision = true;
-                }
+                vFullTxHashes.push_back(nullhash); // placeholder
+                setHashesToRequest.insert(cheapHash);
             }
-            mapPartialTxHash[cheapHash] = mi.second->GetHash();
         }
 
-        if (!_collision)
+        // Reconstruct the block if there are no hashes to re-request
+        if (!_collision && setHashesToRequest.empty())
         {
-            // Start gathering the full tx hashes. If some are not available then add them to setHashesToRequest.
-            uint256 nullhash;
-            for (const uint64_t &cheapHash : vTxHashes)
+            bool mutated;
+            uint256 merkleroot = ComputeMerkleRoot(vFullTxHashes, &mutated);
+            if (header.hashMerkleRoot != merkleroot || mutated)
             {
-                if (mapPartialTxHash.find(cheapHash) != mapPartialTxHash.end())
-                    vFullTxHashes.push_back(mapPartialTxHash[cheapHash]);
-                else
-                {
-                    vFullTxHashes.push_back(nullhash); // placeholder
-                    setHashesToRequest.insert(cheapHash);
-                }
+                fMerkleRootCorrect = false;
             }
-
-            // We don't need this after here.
-            mapPartialTxHash.clear();
-
-            // Reconstruct the block if there are no hashes to re-request
-            if (setHashesToRequest.empty())
+            else
             {
-                bool mutated;
-                uint256 merkleroot = ComputeMerkleRoot(vFullTxHashes, &mutated);
-                if (header.hashMerkleRoot != merkleroot || mutated)
-                {
-                    fMerkleRootCorrect = false;
-                }
-                else
-                {
-                    if (!ReconstructBlock(pfrom, missingCount, unnecessaryCount, thinBlock->vTxHashes256, pblock))
-                        return false;
-                }
+                if (!ReconstructBlock(pfrom, missingCount, unnecessaryCount, thinBlock->vTxHashes256, pblock))
+                    return false;
             }
         }
     } // End locking orphanpool.cs, mempool.cs
@@ -1332,7 +1311,7 @@ void SendXThinBlock(ConstCBlockRef pblock, CNode *pfrom, const CInv &inv)
             }
             else
             {
-                pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+                thinrelay.PushBlock(pfrom, *pblock);
                 LOG(THIN, "Sent regular block instead - thinblock size: %d vs block size: %d => tx hashes: %d "
                           "transactions: %d  peer: %s\n",
                     thinBlock.GetSize(), nSizeBlock, thinBlock.vTxHashes.size(), thinBlock.vMissingTx.size(),
@@ -1354,7 +1333,7 @@ void SendXThinBlock(ConstCBlockRef pblock, CNode *pfrom, const CInv &inv)
             }
             else
             {
-                pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+                thinrelay.PushBlock(pfrom, *pblock);
                 LOG(THIN, "Sent regular block instead - xthinblock size: %d vs block size: %d => tx hashes: %d "
                           "transactions: %d  peer: %s\n",
                     xThinBlock.GetSize(), nSizeBlock, xThinBlock.vTxHashes.size(), xThinBlock.vMissingTx.size(),
@@ -1381,7 +1360,7 @@ void SendXThinBlock(ConstCBlockRef pblock, CNode *pfrom, const CInv &inv)
         }
         else
         {
-            pfrom->PushMessage(NetMsgType::BLOCK, *pblock);
+            thinrelay.PushBlock(pfrom, *pblock);
             LOG(THIN, "Sent regular block instead - thinblock size: %d vs block size: %d => tx hashes: %d "
                       "transactions: %d  peer: %s\n",
                 thinBlock.GetSize(), nSizeBlock, thinBlock.vTxHashes.size(), thinBlock.vMissingTx.size(),
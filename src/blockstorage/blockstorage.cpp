@@ -8,6 +8,7 @@
 
 #include "blockleveldb.h"
 #include "chainparams.h"
+#include "consensus/merkle.h"
 #include "dbwrapper.h"
 #include "fs.h"
 #include "main.h"
@@ -495,6 +496,102 @@ bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus
     return true;
 }
 
+/** Move past one serialized transaction without deserializing it */
+static void SkipTransaction(CMemoryReader &reader)
+{
+    reader.ignore(sizeof(int32_t)); // nVersion
+    for (uint64_t nIn = ReadCompactSize(reader); nIn > 0; nIn--)
+    {
+        reader.ignore(sizeof(uint256) + sizeof(uint32_t)); // prevout
+        reader.ignore(ReadCompactSize(reader)); // scriptSig
+        reader.ignore(sizeof(uint32_t)); // nSequence
+    }
+    for (uint64_t nOut = ReadCompactSize(reader); nOut > 0; nOut--)
+    {
+        reader.ignore(sizeof(CAmount)); // nValue
+        reader.ignore(ReadCompactSize(reader)); // scriptPubKey
+    }
+    reader.ignore(sizeof(uint32_t)); // nLockTime
+}
+
+/**
+ * Check that the raw bytes of a block are exactly the block that the header commits to.  The transactions are
+ * hashed where they are, rather than deserialized first, and must end exactly at the end of the bytes.
+ */
+static bool CheckRawBlockMerkleRoot(const CBlockFileView &view)
+{
+    if (view.size() < SERIALIZED_HEADER_SIZE)
+        return false;
+    try
+    {
+        CBlockHeader header;
+        CMemoryReader reader(SER_DISK, CLIENT_VERSION, view.begin(), view.end());
+        reader >> header;
+        const uint64_t nTx = ReadCompactSize(reader);
+        // A transaction with no inputs and no outputs takes 10 bytes, which bounds how many there can be
+        if (nTx == 0 || nTx > reader.size() / 10)
+            return false;
+        std::vector<uint256> leaves;
+        leaves.reserve(nTx);
+        for (uint64_t i = 0; i < nTx; i++)
+        {
+            const char *pbegin = view.end() - reader.size();
+            SkipTransaction(reader);
+            leaves.push_back(Hash(pbegin, view.end() - reader.size()));
+        }
+        return reader.empty() && ComputeMerkleRoot(std::move(leaves)) == header.hashMerkleRoot;
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+/** Deserialize a block and serialize it again into view, after checking it against its merkle root */
+static bool ReadSerializedBlockFromDisk(CBlockFileView &view,
+    const CBlockIndex *pindex,
+    const CChainParams &chainparams)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
+        return false;
+    if (BlockMerkleRoot(block) != block.hashMerkleRoot)
+    {
+        return error("ReadRawBlockFromDisk: the transactions don't match the merkle root of %s at %s",
+            pindex->ToString(), pindex->GetBlockPos().ToString());
+    }
+    auto buffer = std::make_shared<CDataStream>(SER_DISK, CLIENT_VERSION);
+    *buffer << block;
+    view.Set(buffer, buffer->data(), buffer->size());
+    return true;
+}
+
+bool ReadRawBlockFromDisk(CBlockFileView &view, const CBlockIndex *pindex, const CChainParams &chainparams)
+{
+    // The block database stores deserialized blocks, so serialize one
+    if (pblockdb)
+        return ReadSerializedBlockFromDisk(view, pindex, chainparams);
+
+    if (!ReadRawBlockFromDiskSequential(view, pindex->GetBlockPos(), chainparams.MessageStart()))
+        return false;
+    // The header is at the start of the block, so it can be checked without deserializing the rest
+    if (view.size() < SERIALIZED_HEADER_SIZE ||
+        Hash(view.begin(), view.begin() + SERIALIZED_HEADER_SIZE) != pindex->GetBlockHash())
+    {
+        return error("ReadRawBlockFromDisk: the block header doesn't match index for %s at %s", pindex->ToString(),
+            pindex->GetBlockPos().ToString());
+    }
+    // The header alone says nothing about the bytes after it, which are what a peer spends its time on
+    if (!CheckRawBlockMerkleRoot(view))
+    {
+        LOGA("ReadRawBlockFromDisk: the raw transactions of %s don't match its merkle root, deserializing it\n",
+            pindex->ToString());
+        view = CBlockFileView();
+        return ReadSerializedBlockFromDisk(view, pindex, chainparams);
+    }
+    return true;
+}
+
 bool WriteUndoToDisk(const CBlockUndo &blockundo,
     CDiskBlockPos &pos,
     const CBlockIndex *pindex,
@@ -691,8 +788,10 @@ bool FlushStateToDiskInternal(CValidationState &state,
         {
             return state.Error("out of disk space");
         }
-        // Flush the chainstate (which may refer to block index entries).
-        if (!pcoinsTip->Flush())
+        // Flush the chainstate (which may refer to block index entries).  Only periodic and size triggered
+        // flushes may finish writing to the coin database in the background while validation continues.
+        if (!pcoinsTip->Flush() ||
+            (mode == FLUSH_STATE_ALWAYS && pcoinsdbview != nullptr && !pcoinsdbview->SyncWrites()))
         {
             return AbortNode(state, "Failed to write to coin database");
         }
@@ -6,6 +6,7 @@
 
 #include "blockleveldb.h"
 #include "main.h"
+#include "sequential_files.h"
 #include "undo.h"
 
 enum FlushStateMode
@@ -37,6 +38,13 @@ void SyncStorage(const CChainParams &chainparams);
 
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus::Params &consensusParams);
+/**
+ * Get the serialized bytes of a block without deserializing it.  The header is checked against pindex, and the
+ * transactions are hashed in place and checked against the merkle root.  With sequential block files the bytes are
+ * read from a memory mapping of the file, without a copy.  If the raw bytes fail the check, the block is
+ * deserialized, checked and serialized again instead.
+ */
+bool ReadRawBlockFromDisk(CBlockFileView &view, const CBlockIndex *pindex, const CChainParams &chainparams);
 bool WriteBlockToDisk(const CBlock &block, CDiskBlockPos &pos, const CMessageHeader::MessageStartChars &messageStart);
 
 bool WriteUndoToDisk(const CBlockUndo &blockundo,
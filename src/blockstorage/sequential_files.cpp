@@ -7,6 +7,12 @@
 #include "sequential_files.h"
 
 #include "blockstorage.h"
+#include "chainparams.h"
+#include "crypto/common.h"
+
+#ifndef WIN32
+#include <sys/stat.h>
+#endif
 
 
 extern bool AbortNode(CValidationState &state, const std::string &strMessage, const std::string &userMessage = "");
@@ -59,7 +65,11 @@ void FlushBlockFile(bool fFinalize)
     if (fileOld)
     {
         if (fFinalize)
+        {
+            // A mapping past the new end of the file could not be read
+            UnmapBlockFile(nLastBlockFile);
             TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nSize);
+        }
         FileCommit(fileOld);
         fclose(fileOld);
     }
@@ -79,6 +89,7 @@ void UnlinkPrunedFiles(std::set<int> &setFilesToPrune)
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it)
     {
         CDiskBlockPos pos(*it, 0);
+        UnmapBlockFile(*it);
         fs::remove(GetBlockPosFilename(pos, "blk"));
         fs::remove(GetBlockPosFilename(pos, "rev"));
         LOG(PRUNE, "Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -112,20 +123,165 @@ bool WriteBlockToDiskSequential(const CBlock &block,
     return true;
 }
 
+//! Every block in a block file is preceded by the network magic and its size
+static const unsigned int BLOCK_PREFIX_SIZE = MESSAGE_START_SIZE + sizeof(uint32_t);
+
+#ifndef WIN32
+// Mapping every block file needs more address space than 32 bit systems have
+static const bool fMapBlockFiles = sizeof(void *) >= 8;
+//! At most this many block files are kept mapped; the least recently used mapping is dropped first
+static const size_t MAX_MAPPED_BLOCK_FILES = 256;
+
+namespace
+{
+//! A read-only memory mapping of the first nSize bytes of a block file
+class CBlockFileMapping
+{
+public:
+    const char *const data;
+    const size_t nSize;
+
+    CBlockFileMapping(const char *dataIn, size_t nSizeIn) : data(dataIn), nSize(nSizeIn) {}
+    ~CBlockFileMapping() { munmap((void *)data, nSize); }
+};
+
+struct CMappedBlockFile
+{
+    std::shared_ptr<const CBlockFileMapping> mapping;
+    uint64_t nLastUsed;
+};
+}
+
+static CCriticalSection cs_blockfilemaps;
+static std::map<int, CMappedBlockFile> mapBlockFileMaps GUARDED_BY(cs_blockfilemaps);
+static uint64_t nBlockFileMapUses GUARDED_BY(cs_blockfilemaps) = 0;
+
+/**
+ * Get a mapping of a block file that covers at least its first nRequired bytes.  The newest block file keeps
+ * growing, so it is mapped again when a block past the end of its mapping is read.  Readers that still use the
+ * old mapping keep it alive.
+ */
+static std::shared_ptr<const CBlockFileMapping> MapBlockFile(int nFile, uint64_t nRequired)
+{
+    LOCK(cs_blockfilemaps);
+    auto it = mapBlockFileMaps.find(nFile);
+    if (it != mapBlockFileMaps.end() && it->second.mapping->nSize >= nRequired)
+    {
+        it->second.nLastUsed = ++nBlockFileMapUses;
+        return it->second.mapping;
+    }
+
+    fs::path path = GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk");
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || (uint64_t)st.st_size < nRequired)
+    {
+        close(fd);
+        return nullptr;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+    auto mapping = std::make_shared<const CBlockFileMapping>((const char *)data, st.st_size);
+
+    if (it == mapBlockFileMaps.end() && mapBlockFileMaps.size() >= MAX_MAPPED_BLOCK_FILES)
+    {
+        auto oldest = std::min_element(mapBlockFileMaps.begin(), mapBlockFileMaps.end(),
+            [](const std::pair<const int, CMappedBlockFile> &a, const std::pair<const int, CMappedBlockFile> &b) {
+                return a.second.nLastUsed < b.second.nLastUsed;
+            });
+        mapBlockFileMaps.erase(oldest);
+    }
+    mapBlockFileMaps[nFile] = {mapping, ++nBlockFileMapUses};
+    return mapping;
+}
+
+void UnmapBlockFile(int nFile)
+{
+    LOCK(cs_blockfilemaps);
+    mapBlockFileMaps.erase(nFile);
+}
+
+void UnmapBlockFiles()
+{
+    LOCK(cs_blockfilemaps);
+    mapBlockFileMaps.clear();
+}
+#else
+void UnmapBlockFile(int nFile) {}
+void UnmapBlockFiles() {}
+#endif
+
+bool ReadRawBlockFromDiskSequential(CBlockFileView &view,
+    const CDiskBlockPos &pos,
+    const CMessageHeader::MessageStartChars &messageStart)
+{
+    if (pos.IsNull() || pos.nPos < BLOCK_PREFIX_SIZE)
+        return error("%s: invalid block position %s", __func__, pos.ToString());
+    const unsigned int nPrefixPos = pos.nPos - BLOCK_PREFIX_SIZE;
+
+#ifndef WIN32
+    std::shared_ptr<const CBlockFileMapping> mapping;
+    if (fMapBlockFiles)
+        mapping = MapBlockFile(pos.nFile, pos.nPos);
+    if (mapping)
+    {
+        if (memcmp(mapping->data + nPrefixPos, messageStart, MESSAGE_START_SIZE) != 0)
+            return error("%s: no block at %s", __func__, pos.ToString());
+        const uint32_t nSize = ReadLE32((const unsigned char *)mapping->data + nPrefixPos + MESSAGE_START_SIZE);
+        if (nSize > mapping->nSize - pos.nPos)
+        {
+            mapping = MapBlockFile(pos.nFile, (uint64_t)pos.nPos + nSize);
+            if (!mapping)
+                return error("%s: block at %s is past the end of the file", __func__, pos.ToString());
+        }
+        view.Set(mapping, mapping->data + pos.nPos, nSize);
+        return true;
+    }
+#endif
+
+    // Read the block into a buffer
+    CAutoFile filein(OpenBlockFile(CDiskBlockPos(pos.nFile, nPrefixPos), true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+    try
+    {
+        CMessageHeader::MessageStartChars fileMessageStart;
+        uint32_t nSize;
+        filein >> FLATDATA(fileMessageStart) >> nSize;
+        if (memcmp(fileMessageStart, messageStart, MESSAGE_START_SIZE) != 0)
+            return error("%s: no block at %s", __func__, pos.ToString());
+        if (fseek(filein.Get(), 0, SEEK_END) != 0 || ftell(filein.Get()) < 0 ||
+            (uint64_t)ftell(filein.Get()) < (uint64_t)pos.nPos + nSize || fseek(filein.Get(), pos.nPos, SEEK_SET) != 0)
+            return error("%s: block at %s is past the end of the file", __func__, pos.ToString());
+        auto buffer = std::make_shared<std::vector<char> >(nSize);
+        filein.read(buffer->data(), nSize);
+        view.Set(buffer, buffer->data(), nSize);
+    }
+    catch (const std::exception &e)
+    {
+        return error("%s: I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
 bool ReadBlockFromDiskSequential(CBlock &block, const CDiskBlockPos &pos, const Consensus::Params &consensusParams)
 {
     block.SetNull();
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
+    CBlockFileView view;
+    if (!ReadRawBlockFromDiskSequential(view, pos, Params().MessageStart()))
     {
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+        return error("ReadBlockFromDisk: unable to read the block at %s", pos.ToString());
     }
 
     // Read block
     try
     {
-        filein >> block;
+        CMemoryReader reader(SER_DISK, CLIENT_VERSION, view.begin(), view.end());
+        reader >> block;
     }
     catch (const std::exception &e)
     {
@@ -12,9 +12,42 @@
 #include "undo.h"
 #include "validationinterface.h"
 
+#include <memory>
 #include <set>
 #include <stdint.h>
 
+/**
+ * The serialized bytes of a block.  The bytes stay valid for as long as the view exists, even if the block file
+ * that they are in is pruned meanwhile.
+ */
+class CBlockFileView
+{
+public:
+    const char *begin() const { return pbegin; }
+    const char *end() const { return pbegin + nSize; }
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+    //! The bytes are serialized as they are, so a block can be sent without being deserialized first
+    template <typename Stream>
+    void Serialize(Stream &s) const
+    {
+        s.write(pbegin, nSize);
+    }
+    //! View nSizeIn bytes at pbeginIn, which holderIn keeps valid
+    void Set(std::shared_ptr<const void> holderIn, const char *pbeginIn, size_t nSizeIn)
+    {
+        holder = std::move(holderIn);
+        pbegin = pbeginIn;
+        nSize = nSizeIn;
+    }
+
+private:
+    //! Keeps the mapping of the block file, or a buffer with the bytes, alive
+    std::shared_ptr<const void> holder;
+    const char *pbegin = nullptr;
+    size_t nSize = 0;
+};
+
 
 /** Open a block file (blk?????.dat) */
 FILE *OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly = false);
@@ -34,6 +67,16 @@ bool WriteBlockToDiskSequential(const CBlock &block,
     CDiskBlockPos &pos,
     const CMessageHeader::MessageStartChars &messageStart);
 bool ReadBlockFromDiskSequential(CBlock &block, const CDiskBlockPos &pos, const Consensus::Params &consensusParams);
+/**
+ * Get the serialized bytes of the block at pos, without deserializing them.  Block files are memory mapped where
+ * that is possible, so that reading a block needs no system call and no copy.
+ */
+bool ReadRawBlockFromDiskSequential(CBlockFileView &view,
+    const CDiskBlockPos &pos,
+    const CMessageHeader::MessageStartChars &messageStart);
+/** Drop the memory mappings of block files, for example before they are deleted or truncated */
+void UnmapBlockFile(int nFile);
+void UnmapBlockFiles();
 void FindFilesToPruneSequential(std::set<int> &setFilesToPrune, uint64_t nPruneAfterHeight);
 bool WriteUndoToDiskSequenatial(const CBlockUndo &blockundo,
     CDiskBlockPos &pos,
@@ -16,6 +16,20 @@
 template <typename T>
 class CCheckQueueControl;
 
+/**
+ * Run a batch of checks taken off a CCheckQueue.  Returns false as soon as one of them fails.
+ * Check types that can verify a batch more efficiently than one check at a time provide a non-template
+ * overload for their own type, which is found by argument dependent lookup.
+ */
+template <typename T>
+bool CheckBatch(std::vector<T> &vChecks)
+{
+    for (T &check : vChecks)
+        if (!check())
+            return false;
+    return true;
+}
+
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -143,9 +157,8 @@ private:
                 fOk = fAllOk;
             }
             // execute work
-            for (T &check : vChecks)
-                if (fOk)
-                    fOk = check();
+            if (fOk)
+                fOk = CheckBatch(vChecks);
             vChecks.clear();
         } while (true);
     }
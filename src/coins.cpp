@@ -9,18 +9,34 @@
 #include "consensus/validation.h"
 #include "memusage.h"
 #include "random.h"
+#include "streams.h"
 #include "undo.h"
 #include "util.h"
 
 #include <assert.h>
 Coin emptyCoin;
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
+size_t CCoinsView::GetCoins(const std::vector<COutPoint> &outpoints, std::vector<Coin> &coins) const
+{
+    size_t nFound = 0;
+    coins.assign(outpoints.size(), Coin());
+    for (size_t i = 0; i < outpoints.size(); i++)
+    {
+        if (GetCoin(outpoints[i], coins[i]))
+            nFound++;
+        else
+            coins[i].Clear();
+    }
+    return nFound;
+}
 bool CCoinsView::HaveCoin(const COutPoint &outpoint) const { return false; }
 uint256 CCoinsView::_GetBestBlock() const { return uint256(); }
+bool CCoinsView::GetUtxoCommitment(CECMultiSet &commitment) const { return false; }
 bool CCoinsView::BatchWrite(CCoinsMap &mapCoins,
     const uint256 &hashBlock,
     const uint64_t nBestCoinHeight,
-    size_t &nChildCachedCoinsUsage)
+    size_t &nChildCachedCoinsUsage,
+    const CECMultiSet &commitmentDelta)
 {
     return false;
 }
@@ -29,13 +45,18 @@ CCoinsViewBacked::CCoinsViewBacked(CCoinsView *viewIn) : base(viewIn) {}
 bool CCoinsViewBacked::GetCoin(const COutPoint &outpoint, Coin &coin) const { return base->GetCoin(outpoint, coin); }
 bool CCoinsViewBacked::HaveCoin(const COutPoint &outpoint) const { return base->HaveCoin(outpoint); }
 uint256 CCoinsViewBacked::_GetBestBlock() const { return base->GetBestBlock(); }
+bool CCoinsViewBacked::GetUtxoCommitment(CECMultiSet &commitment) const
+{
+    return base->GetUtxoCommitment(commitment);
+}
 void CCoinsViewBacked::SetBackend(CCoinsView &viewIn) { base = &viewIn; }
 bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins,
     const uint256 &hashBlock,
     const uint64_t nBestCoinHeight,
-    size_t &nChildCachedCoinsUsage)
+    size_t &nChildCachedCoinsUsage,
+    const CECMultiSet &commitmentDelta)
 {
-    return base->BatchWrite(mapCoins, hashBlock, nBestCoinHeight, nChildCachedCoinsUsage);
+    return base->BatchWrite(mapCoins, hashBlock, nBestCoinHeight, nChildCachedCoinsUsage, commitmentDelta);
 }
 CCoinsViewCursor *CCoinsViewBacked::Cursor() const { return base->Cursor(); }
 size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
@@ -44,80 +65,105 @@ SaltedOutpointHasher::SaltedOutpointHasher()
 {
 }
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), nBestCoinHeight(0), cachedCoinsUsage(0)
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn)
+    : CCoinsViewBacked(baseIn), nBestCoinHeight(0), nClockStripe(0), nClockSlot(0), cachedCoinsUsage(0)
 {
 }
 
+void CCoinsViewCache::UpdateBestCoinHeight(uint64_t nHeight) const
+{
+    uint64_t nBest = nBestCoinHeight.load();
+    while (nBest < nHeight && !nBestCoinHeight.compare_exchange_weak(nBest, nHeight))
+    {
+    }
+}
+
 size_t CCoinsViewCache::DynamicMemoryUsage() const
 {
     READLOCK(cs_utxo);
-    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
+    size_t nUsage = cachedCoinsUsage;
+    for (size_t i = 0; i < COINS_CACHE_STRIPES; i++)
+    {
+        READLOCK(csStripe[i]);
+        nUsage += cacheCoins.stripe(i).DynamicMemoryUsage();
+    }
+    return nUsage;
 }
 size_t CCoinsViewCache::_DynamicMemoryUsage() const { return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage; }
 size_t CCoinsViewCache::ResetCachedCoinUsage() const
 {
     bool drifted = false;
     size_t newCachedCoinsUsage = 0;
+    size_t oldCachedCoinsUsage = 0;
     {
-        READLOCK(cs_utxo);
+        // Coins can be added to other stripes under a shared cs_utxo, so walking the whole map needs it exclusive
+        WRITELOCK(cs_utxo);
         for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++)
             newCachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
-        drifted = (cachedCoinsUsage != newCachedCoinsUsage);
+        oldCachedCoinsUsage = cachedCoinsUsage.exchange(newCachedCoinsUsage);
+        drifted = (oldCachedCoinsUsage != newCachedCoinsUsage);
     }
     if (drifted)
     {
-        error(
-            "Resetting: cachedCoinsUsage has drifted - before %lld after %lld", cachedCoinsUsage, newCachedCoinsUsage);
-        cachedCoinsUsage = newCachedCoinsUsage;
+        error("Resetting: cachedCoinsUsage has drifted - before %lld after %lld", oldCachedCoinsUsage,
+            newCachedCoinsUsage);
     }
     return newCachedCoinsUsage;
 }
 
-CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint, CDeferredSharedLocker *lock) const
+CCoinsCacheEntry *CCoinsViewCache::FetchCoin(const COutPoint &outpoint,
+    uint64_t hash,
+    CDeferredSharedLocker *lock) const
 {
+    CCoinsMap::stripe_type &stripe = Stripe(hash);
     // When fetching a coin, we only need the shared lock if the coin exists in the cache.
     // So we have the Locker object take the shared lock and return with the read lock held if the coin was in cache.
     {
         if (lock)
             lock->lock_shared();
-        CCoinsMap::iterator it = cacheCoins.find(outpoint);
-        if (it != cacheCoins.end())
-            return it;
+        CCoinsMap::stripe_type::iterator it = stripe.find(outpoint, hash);
+        if (it != stripe.end())
+        {
+            it->second.Touch();
+            return &it->second;
+        }
         if (lock)
             lock->unlock();
     }
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
-        return cacheCoins.end();
+        return nullptr;
 
     // But if the coin is NOT in the cache, we need to grab the exclusive lock in order to modify the cache
     if (lock)
         lock->lock();
-    CCoinsMap::iterator ret =
-        cacheCoins
-            .emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp)))
-            .first;
-    if (ret->second.coin.IsSpent())
+    // Another thread may have loaded or added this coin while the stripe was unlocked, in which case its entry wins
+    std::pair<CCoinsMap::stripe_type::iterator, bool> ret = stripe.emplace_hashed(
+        hash, std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp)));
+    CCoinsCacheEntry &entry = ret.first->second;
+    if (ret.second)
     {
-        // The parent only has an empty entry for this outpoint; we can consider our
-        // version as fresh.
-        ret->second.flags = CCoinsCacheEntry::FRESH;
+        if (entry.coin.IsSpent())
+        {
+            // The parent only has an empty entry for this outpoint; we can consider our
+            // version as fresh.
+            entry.flags = CCoinsCacheEntry::FRESH;
+        }
+        cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
+        UpdateBestCoinHeight(entry.coin.nHeight);
     }
-    cachedCoinsUsage += ret->second.coin.DynamicMemoryUsage();
-
-    if (nBestCoinHeight < ret->second.coin.nHeight)
-        nBestCoinHeight = ret->second.coin.nHeight;
-
-    return ret;
+    return &entry;
 }
 
 bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const
 {
-    CDeferredSharedLocker lock(cs_utxo);
-    CCoinsMap::const_iterator it = FetchCoin(outpoint, &lock);
-    if (it != cacheCoins.end())
+    READLOCK(cs_utxo);
+    const uint64_t hash = cacheCoins.hash_key(outpoint);
+    CDeferredSharedLocker lock(StripeLock(hash));
+    const CCoinsCacheEntry *entry = FetchCoin(outpoint, hash, &lock);
+    if (entry)
     {
-        coin = it->second.coin;
+        coin = entry->coin;
         return true;
     }
     return false;
@@ -125,14 +171,43 @@ bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const
 
 void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin &&coin, bool possible_overwrite)
 {
-    WRITELOCK(cs_utxo);
     assert(!coin.IsSpent());
     if (coin.out.scriptPubKey.IsUnspendable())
         return;
-    CCoinsMap::iterator it;
+    READLOCK(cs_utxo);
+    const uint64_t hash = cacheCoins.hash_key(outpoint);
+
+    // Hash the coin into the commitment, and read and hash the coin it overwrites, before locking the stripe so
+    // that neither holds up the other users of the stripe.  The outputs of a transaction are only ever added by one
+    // thread, so the overwritten coin can not change in the meantime.
+    CECMultiSet delta;
+    UpdateUtxoCommitment(delta, outpoint, coin, true);
+    if (possible_overwrite)
+    {
+        // Only look at the overwritten coin: bringing it into the cache the way FetchCoin does would mark a coin
+        // that the parent has spent as FRESH, which an overwrite must not be
+        Coin old;
+        bool fCached = false;
+        {
+            READLOCK(StripeLock(hash));
+            CCoinsMap::stripe_type::const_iterator it = Stripe(hash).find(outpoint, hash);
+            if (it != Stripe(hash).end())
+            {
+                old = it->second.coin;
+                fCached = true;
+            }
+        }
+        if (!fCached)
+            base->GetCoin(outpoint, old);
+        if (!old.IsSpent())
+            UpdateUtxoCommitment(delta, outpoint, old, false);
+    }
+
+    WRITELOCK(StripeLock(hash));
+    CCoinsMap::stripe_type::iterator it;
     bool inserted;
     std::tie(it, inserted) =
-        cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
+        Stripe(hash).emplace_hashed(hash, std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
     bool fresh = false;
     if (!inserted)
     {
@@ -146,32 +221,48 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin &&coin, bool possi
         }
         fresh = !(it->second.flags & CCoinsCacheEntry::DIRTY);
     }
+    commitmentDelta[CCoinsMap::stripe_of(hash)].Combine(delta);
     it->second.coin = std::move(coin);
     it->second.flags |= CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0);
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
-    if (nBestCoinHeight < it->second.coin.nHeight)
-        nBestCoinHeight = it->second.coin.nHeight;
+    UpdateBestCoinHeight(it->second.coin.nHeight);
 }
 
 void CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin *moveout)
 {
-    WRITELOCK(cs_utxo);
-    CCoinsMap::iterator it = FetchCoin(outpoint, nullptr);
-    if (it == cacheCoins.end())
-        return;
-    cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
-    if (moveout)
+    READLOCK(cs_utxo);
+    const uint64_t hash = cacheCoins.hash_key(outpoint);
+    Coin spent;
     {
-        *moveout = std::move(it->second.coin);
+        WRITELOCK(StripeLock(hash));
+        CCoinsCacheEntry *entry = FetchCoin(outpoint, hash, nullptr);
+        if (!entry)
+            return;
+        cachedCoinsUsage -= entry->coin.DynamicMemoryUsage();
+        spent = std::move(entry->coin);
+        if (entry->flags & CCoinsCacheEntry::FRESH)
+        {
+            Stripe(hash).erase(outpoint, hash);
+        }
+        else
+        {
+            entry->flags |= CCoinsCacheEntry::DIRTY;
+            entry->coin.Clear();
+        }
     }
-    if (it->second.flags & CCoinsCacheEntry::FRESH)
+
+    // Hash the spent coin out of the commitment without holding the stripe, then lock it again just to fold the
+    // result into its delta
+    if (!spent.IsSpent())
     {
-        cacheCoins.erase(it);
+        CECMultiSet delta;
+        UpdateUtxoCommitment(delta, outpoint, spent, false);
+        WRITELOCK(StripeLock(hash));
+        commitmentDelta[CCoinsMap::stripe_of(hash)].Combine(delta);
     }
-    else
+    if (moveout)
     {
-        it->second.flags |= CCoinsCacheEntry::DIRTY;
-        it->second.coin.Clear();
+        *moveout = std::move(spent);
     }
 }
 
@@ -180,54 +271,104 @@ static const Coin coinEmpty;
 const Coin &CCoinsViewCache::_AccessCoin(const COutPoint &outpoint) const
 {
     AssertLockHeld(cs_utxo);
-    CCoinsMap::const_iterator it = FetchCoin(outpoint, nullptr);
-    if (it == cacheCoins.end())
+    const uint64_t hash = cacheCoins.hash_key(outpoint);
+    WRITELOCK(StripeLock(hash));
+    const CCoinsCacheEntry *entry = FetchCoin(outpoint, hash, nullptr);
+    if (!entry)
     {
         return coinEmpty;
     }
     else
     {
-        return it->second.coin;
+        return entry->coin;
     }
 }
 
 bool CCoinsViewCache::HaveCoin(const COutPoint &outpoint) const
 {
-    CDeferredSharedLocker lock(cs_utxo);
-    CCoinsMap::const_iterator it = FetchCoin(outpoint, &lock);
-    return (it != cacheCoins.end() && !it->second.coin.IsSpent());
+    READLOCK(cs_utxo);
+    const uint64_t hash = cacheCoins.hash_key(outpoint);
+    CDeferredSharedLocker lock(StripeLock(hash));
+    const CCoinsCacheEntry *entry = FetchCoin(outpoint, hash, &lock);
+    return (entry && !entry->coin.IsSpent());
 }
 
 bool CCoinsViewCache::GetCoinFromDB(const COutPoint &outpoint) const
 {
+    // Hold cs_utxo while reading the base, so that a flush can not change the base between the read and the insert
+    READLOCK(cs_utxo);
     Coin coin;
     if (!base->GetCoin(outpoint, coin))
         return false;
 
-    WRITELOCK(cs_utxo);
-    CCoinsMap::iterator ret =
-        cacheCoins
-            .emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)))
-            .first;
-    if (ret->second.coin.IsSpent())
+    const uint64_t hash = cacheCoins.hash_key(outpoint);
+    WRITELOCK(StripeLock(hash));
+    std::pair<CCoinsMap::stripe_type::iterator, bool> ret = Stripe(hash).emplace_hashed(
+        hash, std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)));
+    CCoinsCacheEntry &entry = ret.first->second;
+    if (ret.second)
     {
-        // The parent only has an empty entry for this outpoint; we can consider our
-        // version as fresh.
-        ret->second.flags = CCoinsCacheEntry::FRESH;
+        if (entry.coin.IsSpent())
+        {
+            // The parent only has an empty entry for this outpoint; we can consider our
+            // version as fresh.
+            entry.flags = CCoinsCacheEntry::FRESH;
+        }
+        cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
+        UpdateBestCoinHeight(entry.coin.nHeight);
     }
-    cachedCoinsUsage += ret->second.coin.DynamicMemoryUsage();
 
-    if (nBestCoinHeight < ret->second.coin.nHeight)
-        nBestCoinHeight = ret->second.coin.nHeight;
+    return !entry.coin.IsSpent();
+}
 
-    return !ret->second.coin.IsSpent();
+size_t CCoinsViewCache::GetCoinsFromDB(const std::vector<COutPoint> &outpoints) const
+{
+    READLOCK(cs_utxo);
+    std::vector<COutPoint> missing;
+    missing.reserve(outpoints.size());
+    for (const COutPoint &outpoint : outpoints)
+    {
+        const uint64_t hash = cacheCoins.hash_key(outpoint);
+        READLOCK(StripeLock(hash));
+        const CCoinsMap::stripe_type &stripe = Stripe(hash);
+        if (stripe.find(outpoint, hash) == stripe.end())
+            missing.push_back(outpoint);
+    }
+    if (missing.empty())
+        return 0;
+
+    std::vector<Coin> coins;
+    if (base->GetCoins(missing, coins) == 0)
+        return 0;
+
+    size_t nLoaded = 0;
+    for (size_t i = 0; i < missing.size(); i++)
+    {
+        if (coins[i].IsSpent())
+            continue;
+        const uint64_t hash = cacheCoins.hash_key(missing[i]);
+        WRITELOCK(StripeLock(hash));
+        std::pair<CCoinsMap::stripe_type::iterator, bool> ret = Stripe(hash).emplace_hashed(hash,
+            std::piecewise_construct, std::forward_as_tuple(missing[i]), std::forward_as_tuple(std::move(coins[i])));
+        if (ret.second)
+        {
+            const CCoinsCacheEntry &entry = ret.first->second;
+            cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
+            UpdateBestCoinHeight(entry.coin.nHeight);
+            nLoaded++;
+        }
+    }
+    return nLoaded;
 }
 
 bool CCoinsViewCache::HaveCoinInCache(const COutPoint &outpoint, bool &fSpent) const
 {
     READLOCK(cs_utxo);
-    CCoinsMap::const_iterator it = cacheCoins.find(outpoint);
-    bool fHave = (it != cacheCoins.end());
+    const uint64_t hash = cacheCoins.hash_key(outpoint);
+    READLOCK(StripeLock(hash));
+    const CCoinsMap::stripe_type &stripe = Stripe(hash);
+    CCoinsMap::stripe_type::const_iterator it = stripe.find(outpoint, hash);
+    bool fHave = (it != stripe.end());
     if (fHave)
         fSpent = it->second.coin.IsSpent();
     return fHave;
@@ -248,6 +389,19 @@ uint256 CCoinsViewCache::_GetBestBlock() const
     return hashBlock;
 }
 
+bool CCoinsViewCache::GetUtxoCommitment(CECMultiSet &commitment) const
+{
+    READLOCK(cs_utxo);
+    if (!base->GetUtxoCommitment(commitment))
+        return false;
+    for (size_t i = 0; i < COINS_CACHE_STRIPES; i++)
+    {
+        READLOCK(csStripe[i]);
+        commitment.Combine(commitmentDelta[i]);
+    }
+    return true;
+}
+
 void CCoinsViewCache::SetBestBlock(const uint256 &hashBlockIn)
 {
     WRITELOCK(cs_utxo);
@@ -257,9 +411,11 @@ void CCoinsViewCache::SetBestBlock(const uint256 &hashBlockIn)
 bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins,
     const uint256 &hashBlockIn,
     const uint64_t nBestCoinHeightIn,
-    size_t &nChildCachedCoinsUsage)
+    size_t &nChildCachedCoinsUsage,
+    const CECMultiSet &commitmentDeltaIn)
 {
     WRITELOCK(cs_utxo);
+    commitmentDelta[0].Combine(commitmentDeltaIn);
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();)
     {
         if (it->second.flags & CCoinsCacheEntry::DIRTY)
@@ -313,6 +469,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins,
                     itUs->second.coin = std::move(it->second.coin);
                     cachedCoinsUsage += itUs->second.coin.DynamicMemoryUsage();
                     itUs->second.flags |= CCoinsCacheEntry::DIRTY;
+                    itUs->second.Touch();
                 }
             }
 
@@ -332,7 +489,18 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins,
 bool CCoinsViewCache::Flush()
 {
     WRITELOCK(cs_utxo);
-    bool fOk = base->BatchWrite(cacheCoins, hashBlock, nBestCoinHeight, cachedCoinsUsage);
+    size_t nUsage = cachedCoinsUsage;
+    CECMultiSet delta;
+    for (const CECMultiSet &stripeDelta : commitmentDelta)
+        delta.Combine(stripeDelta);
+    bool fOk = base->BatchWrite(cacheCoins, hashBlock, nBestCoinHeight, nUsage, delta);
+    cachedCoinsUsage = nUsage;
+    // The base only has the changes once the write succeeded
+    if (fOk)
+    {
+        for (CECMultiSet &stripeDelta : commitmentDelta)
+            stripeDelta.SetEmpty();
+    }
     return fOk;
 }
 
@@ -340,116 +508,70 @@ void CCoinsViewCache::Trim(size_t nTrimSize) const
 {
     WRITELOCK(cs_utxo);
 
+    // Evicted entries go on the free list of their stripe and are reused by the next inserts, so the cache does
+    // not grow again until it has been refilled.  Only count the memory of the entries that are still in use.
+    size_t nUsage = _DynamicMemoryUsage() - cacheCoins.FreeMemoryUsage();
+    if (nUsage <= nTrimSize)
+        return;
+    LOG(COINDB, "cacheCoinsUsage at start: %d total dynamic usage: %d trim to size: %d\n", cachedCoinsUsage.load(),
+        nUsage, nTrimSize);
+
+    // Every pass of the hand ages the entries it does not evict, so after MAX_RECENT + 1 passes every clean
+    // entry has been evicted.  Only dirty entries can stop us from reaching nTrimSize.
+    uint64_t nVisits = (CCoinsCacheEntry::MAX_RECENT + 2) * (uint64_t)cacheCoins.size();
     uint64_t nTrimmed = 0;
-    uint64_t nTrimmedByHeight = 0;
-    static uint64_t nTrimHeightDelta = nBestCoinHeight * 0.80; // This is where we attempt to do our first trim
-    uint64_t nTrimHeight = nBestCoinHeight - nTrimHeightDelta;
-
-    // Begin first Trim loop. This loop will trim coins from cache by the coin height, removing the oldest coins first.
-    // This has been proven to improve sync performance significantly for nodes that can not hold the entire dbcache
-    // in memory.
-    bool fDone = false;
-    uint64_t nSmallestDelta = 50; // number of blocks to adjust trim height by
-    CCoinsMap::iterator iter = cacheCoins.begin();
-    while (!fDone && _DynamicMemoryUsage() > nTrimSize)
-    {
-        LOG(COINDB, "cacheCoinsUsage at start: %d total dynamic usage: %d trim to size: %d nBestCoinHeight: %d "
-                    "trim height:%d\n",
-            cachedCoinsUsage, _DynamicMemoryUsage(), nTrimSize, nBestCoinHeight, nTrimHeight);
-
-        iter = cacheCoins.begin();
-        while (_DynamicMemoryUsage() > nTrimSize)
+    while (nUsage > nTrimSize && nVisits > 0 && !cacheCoins.empty())
+    {
+        CCoinsMap::stripe_type &stripe = cacheCoins.stripe(nClockStripe);
+        CCoinsMap::stripe_type::iterator it = stripe.from_slot(nClockSlot);
+        for (; it != stripe.end() && nUsage > nTrimSize && nVisits > 0; nVisits--)
         {
-            if (iter == cacheCoins.end())
+            CCoinsCacheEntry &entry = it->second;
+            uint8_t nRecent = entry.nRecent.load(std::memory_order_relaxed);
+            // Only erase entries that have not been modified
+            if (entry.flags == 0 && nRecent == 0)
             {
-                fDone = true;
-                break;
-            }
-
-            if (iter->second.flags == 0 && iter->second.coin.nHeight < nTrimHeight)
-            {
-                cachedCoinsUsage -= iter->second.coin.DynamicMemoryUsage();
-
-                iter = cacheCoins.erase(iter);
+                cachedCoinsUsage -= entry.coin.DynamicMemoryUsage();
+                it = stripe.erase(it);
                 nTrimmed++;
-                nTrimmedByHeight++;
+                nUsage = _DynamicMemoryUsage() - cacheCoins.FreeMemoryUsage();
             }
             else
-                iter++;
+            {
+                if (nRecent > 0)
+                    entry.nRecent.store(nRecent - 1, std::memory_order_relaxed);
+                ++it;
+            }
         }
-
-        // Gradually increase the nTrimHeight if we didn't trim enought entries.
-        if (fDone && _DynamicMemoryUsage() > nTrimSize && nTrimHeightDelta > nSmallestDelta)
+        if (it == stripe.end())
         {
-            if (nTrimHeightDelta <= nSmallestDelta * 100)
-                nTrimHeightDelta =
-                    (nTrimHeightDelta > (nSmallestDelta * 2) ? nTrimHeightDelta - (nSmallestDelta * 2) : 0);
-            else if (nTrimHeightDelta <= nSmallestDelta * 400)
-                nTrimHeightDelta =
-                    (nTrimHeightDelta > (nSmallestDelta * 10) ? nTrimHeightDelta - (nSmallestDelta * 10) : 0);
-            else
-                nTrimHeightDelta =
-                    (nTrimHeightDelta > (nSmallestDelta * 200) ? nTrimHeightDelta - (nSmallestDelta * 200) : 0);
-
-            nTrimHeight = (nBestCoinHeight > nTrimHeightDelta ? nBestCoinHeight - nTrimHeightDelta : 0);
-
-            // We're not done yet. We've adjusted the nTrimHeight so we have to go back and trim again.
-            fDone = false;
-
-            LOG(COINDB, "Re-adjusting trim height to %d using a trim height delta of %d\n", nTrimHeight,
-                nTrimHeightDelta);
-        }
-    }
-
-    // If trimming by coin height failed to find any or enough coins to trim then trim the cache by ignoring
-    // coin height. While this is not ideal we still have to trim to keep the cache from growing unbounded.
-    iter = cacheCoins.begin();
-    while (_DynamicMemoryUsage() > nTrimSize)
-    {
-        if (iter == cacheCoins.end())
-            break;
-
-        // Only erase entries that have not been modified
-        if (iter->second.flags == 0)
-        {
-            cachedCoinsUsage -= iter->second.coin.DynamicMemoryUsage();
-
-            iter = cacheCoins.erase(iter);
-            nTrimmed++;
+            // Move the hand on to the next stripe
+            nClockStripe = (nClockStripe + 1) % COINS_CACHE_STRIPES;
+            nClockSlot = 0;
         }
         else
-            iter++;
+            nClockSlot = stripe.slot_index(it);
     }
     if (nTrimmed > 0)
     {
-        LOG(COINDB, "Trimmed %d by coin height\n", nTrimmedByHeight);
         LOG(COINDB, "Trimmed %ld from the CoinsViewCache, current size after trim: %ld and usage %ld bytes\n", nTrimmed,
-            cacheCoins.size(), cachedCoinsUsage);
-    }
-
-    // If we're not trimming anything then gradually walk the trim height backwards from the tip.  This is to adjust
-    // and account for the possiblity that the average block size could be getting smaller for certain periods of time
-    // and thus we can keep more of the recent coins from getting trimmed.
-    if (nTrimmedByHeight == 0 && nTrimmed == 0)
-    {
-        nTrimHeightDelta += nSmallestDelta;
-        if (nTrimHeightDelta > nBestCoinHeight)
-            nTrimHeightDelta = nBestCoinHeight;
-        nTrimHeight = nBestCoinHeight - nTrimHeightDelta;
-        LOG(COINDB, "Re-adjusting trim height to %d using a trim height delta of %d\n", nTrimHeight, nTrimHeightDelta);
+            cacheCoins.size(), cachedCoinsUsage.load());
     }
 }
 
-void CCoinsViewCache::Uncache(const COutPoint &hash)
+void CCoinsViewCache::Uncache(const COutPoint &outpoint)
 {
-    WRITELOCK(cs_utxo);
-    CCoinsMap::iterator it = cacheCoins.find(hash);
+    READLOCK(cs_utxo);
+    const uint64_t hash = cacheCoins.hash_key(outpoint);
+    WRITELOCK(StripeLock(hash));
+    CCoinsMap::stripe_type &stripe = Stripe(hash);
+    CCoinsMap::stripe_type::iterator it = stripe.find(outpoint, hash);
 
     // only uncache coins that are not dirty.
-    if (it != cacheCoins.end() && it->second.flags == 0)
+    if (it != stripe.end() && it->second.flags == 0)
     {
         cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
-        cacheCoins.erase(it);
+        stripe.erase(it);
     }
 }
 
@@ -462,18 +584,26 @@ void CCoinsViewCache::UncacheTx(const CTransaction &tx)
 unsigned int CCoinsViewCache::GetCacheSize() const
 {
     READLOCK(cs_utxo);
-    return cacheCoins.size();
+    size_t nSize = 0;
+    for (size_t i = 0; i < COINS_CACHE_STRIPES; i++)
+    {
+        READLOCK(csStripe[i]);
+        nSize += cacheCoins.stripe(i).size();
+    }
+    return nSize;
 }
 
 CAmount CCoinsViewCache::GetValueIn(const CTransaction &tx) const
 {
-    READLOCK(cs_utxo);
     if (tx.IsCoinBase())
         return 0;
 
     CAmount nResult = 0;
     for (unsigned int i = 0; i < tx.vin.size(); i++)
-        nResult += _AccessCoin(tx.vin[i].prevout).out.nValue;
+    {
+        CoinAccessor coin(*this, tx.vin[i].prevout);
+        nResult += coin->out.nValue;
+    }
 
     return nResult;
 }
@@ -495,20 +625,19 @@ bool CCoinsViewCache::HaveInputs(const CTransaction &tx) const
 
 double CCoinsViewCache::GetPriority(const CTransaction &tx, int nHeight, CAmount &inChainInputValue) const
 {
-    READLOCK(cs_utxo);
     inChainInputValue = 0;
     if (tx.IsCoinBase())
         return 0.0;
     double dResult = 0.0;
     for (const CTxIn &txin : tx.vin)
     {
-        const Coin &coin = _AccessCoin(txin.prevout);
-        if (coin.IsSpent())
+        CoinAccessor coin(*this, txin.prevout);
+        if (coin->IsSpent())
             continue;
-        if (coin.nHeight <= nHeight)
+        if (coin->nHeight <= nHeight)
         {
-            dResult += coin.out.nValue * (nHeight - coin.nHeight);
-            inChainInputValue += coin.out.nValue;
+            dResult += coin->out.nValue * (nHeight - coin->nHeight);
+            inChainInputValue += coin->out.nValue;
         }
     }
     return tx.ComputePriority(dResult);
@@ -519,34 +648,34 @@ CCoinsViewCursor::~CCoinsViewCursor() {}
 static const size_t nMaxOutputsPerBlock =
     DEFAULT_LARGEST_TRANSACTION / ::GetSerializeSize(CTxOut(), SER_NETWORK, PROTOCOL_VERSION);
 
-CoinAccessor::CoinAccessor(const CCoinsViewCache &view, const uint256 &txid) : cache(&view), lock(cache->csCacheInsert)
+// Returns the first unspent output of txid, or an outpoint past the last possible output if there is none
+static COutPoint FirstUnspentOutput(const CCoinsViewCache &view, const uint256 &txid)
 {
-    EnterCritical("CCoinsViewCache.cs_utxo", __FILE__, __LINE__, (void *)(&cache->cs_utxo), LockType::SHARED_MUTEX,
-        OwnershipType::SHARED);
-    cache->cs_utxo.lock_shared();
     COutPoint iter(txid, 0);
-    coin = &emptyCoin;
     while (iter.n < nMaxOutputsPerBlock)
     {
-        const Coin &alternate = view._AccessCoin(iter);
-        if (!alternate.IsSpent())
-        {
-            coin = &alternate;
-            return;
-        }
+        CoinAccessor alternate(view, iter);
+        if (!alternate->IsSpent())
+            break;
         ++iter.n;
     }
+    return iter;
+}
+
+CoinAccessor::CoinAccessor(const CCoinsViewCache &view, const uint256 &txid)
+    : CoinAccessor(view, FirstUnspentOutput(view, txid))
+{
 }
 
 CoinAccessor::CoinAccessor(const CCoinsViewCache &cacheObj, const COutPoint &output)
-    : cache(&cacheObj), lock(cache->csCacheInsert)
+    : cache(&cacheObj), hash(cache->cacheCoins.hash_key(output)), coin(nullptr), lock(cache->StripeLock(hash))
 {
     EnterCritical("CCoinsViewCache.cs_utxo", __FILE__, __LINE__, (void *)(&cache->cs_utxo), LockType::SHARED_MUTEX,
         OwnershipType::SHARED);
     cache->cs_utxo.lock_shared();
-    it = cache->FetchCoin(output, &lock);
-    if (it != cache->cacheCoins.end())
-        coin = &it->second.coin;
+    const CCoinsCacheEntry *entry = cache->FetchCoin(output, hash, &lock);
+    if (entry)
+        coin = &entry->coin;
     else
         coin = &emptyCoin;
 }
@@ -554,6 +683,8 @@ CoinAccessor::CoinAccessor(const CCoinsViewCache &cacheObj, const COutPoint &out
 CoinAccessor::~CoinAccessor()
 {
     coin = nullptr;
+    // The stripe lock must be released before cs_utxo, which is what keeps whole-cache operations out
+    lock.unlock();
     cache->cs_utxo.unlock_shared();
     LeaveCritical(&cache->cs_utxo);
 }
@@ -564,9 +695,9 @@ CoinModifier::CoinModifier(const CCoinsViewCache &cacheObj, const COutPoint &out
     EnterCritical("CCoinsViewCache.cs_utxo", __FILE__, __LINE__, (void *)(&cache->cs_utxo), LockType::SHARED_MUTEX,
         OwnershipType::EXCLUSIVE);
     cache->cs_utxo.lock();
-    it = cache->FetchCoin(output, nullptr);
-    if (it != cache->cacheCoins.end())
-        coin = &it->second.coin;
+    const CCoinsCacheEntry *entry = cache->FetchCoin(output, cache->cacheCoins.hash_key(output), nullptr);
+    if (entry)
+        coin = &entry->coin;
     else
         coin = &emptyCoin;
 }
@@ -578,6 +709,18 @@ CoinModifier::~CoinModifier()
     LeaveCritical(&cache->cs_utxo);
 }
 
+void UpdateUtxoCommitment(CECMultiSet &commitment, const COutPoint &outpoint, const Coin &coin, bool fAdd)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << outpoint;
+    ss << (uint32_t)(coin.nHeight * 2 + coin.fCoinBase);
+    ss << coin.out;
+    if (fAdd)
+        commitment.Add((const unsigned char *)ss.data(), ss.size());
+    else
+        commitment.Remove((const unsigned char *)ss.data(), ss.size());
+}
+
 void AddCoins(CCoinsViewCache &cache, const CTransaction &tx, int nHeight)
 {
     bool fCoinbase = tx.IsCoinBase();
@@ -9,6 +9,8 @@
 
 #include "compressor.h"
 #include "core_memusage.h"
+#include "ecmultiset.h"
+#include "flatmap.h"
 #include "hashwrapper.h"
 #include "memusage.h"
 #include "serialize.h"
@@ -16,13 +18,12 @@
 #include "uint256.h"
 
 #include <assert.h>
+#include <atomic>
 #include <stdint.h>
 
 #include <boost/thread/locks.hpp>
 #include <boost/thread/shared_mutex.hpp>
 
-#include <unordered_map>
-
 class CTxUndo;
 class CValidationState;
 
@@ -33,12 +34,19 @@ struct CCoinsStats
     uint64_t nTransactions;
     uint64_t nTransactionOutputs;
     uint64_t nSerializedSize;
+    //! The hash of the whole serialized set
     uint256 hashSerialized;
+    //! The hash of the hashes of the serialized set in ranges of txids (see GetUTXOStats)
+    uint256 hashSerializedRanges;
     uint64_t nDiskSize;
     CAmount nTotalAmount;
+    //! The UTXO set commitment, if it is known
+    bool fHaveUtxoCommitment;
+    uint256 hashUtxoCommitment;
 
     CCoinsStats()
-        : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nDiskSize(0), nTotalAmount(0)
+        : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nDiskSize(0), nTotalAmount(0),
+          fHaveUtxoCommitment(false)
     {
     }
 };
@@ -120,18 +128,60 @@ struct CCoinsCacheEntry
 {
     Coin coin; // The actual cached data.
     unsigned char flags;
+    /**
+     * How recently and how often the entry was used, for the eviction clock of CCoinsViewCache::Trim: every use
+     * counts up to MAX_RECENT, every pass of the clock hand counts down, and the entry is evicted at 0.  Entries
+     * are used under a shared lock, so this is atomic.
+     */
+    mutable std::atomic<uint8_t> nRecent;
 
     enum Flags
     {
         DIRTY = (1 << 0), // This cache entry is potentially different from the version in the parent view.
         FRESH = (1 << 1), // The parent view does not have this entry (or it is pruned).
     };
+    enum
+    {
+        MAX_RECENT = 3
+    };
 
-    CCoinsCacheEntry() : flags(0) {}
-    explicit CCoinsCacheEntry(Coin &&coin_) : coin(std::move(coin_)), flags(0) {}
+    CCoinsCacheEntry() : flags(0), nRecent(1) {}
+    explicit CCoinsCacheEntry(Coin &&coin_) : coin(std::move(coin_)), flags(0), nRecent(1) {}
+    CCoinsCacheEntry(CCoinsCacheEntry &&other)
+        : coin(std::move(other.coin)), flags(other.flags), nRecent(other.nRecent.load(std::memory_order_relaxed))
+    {
+    }
+    CCoinsCacheEntry(const CCoinsCacheEntry &other)
+        : coin(other.coin), flags(other.flags), nRecent(other.nRecent.load(std::memory_order_relaxed))
+    {
+    }
+    CCoinsCacheEntry &operator=(const CCoinsCacheEntry &other)
+    {
+        coin = other.coin;
+        flags = other.flags;
+        nRecent.store(other.nRecent.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+
+    //! Record a use of the entry.  Concurrent uses may count as one, which is good enough for eviction
+    void Touch() const
+    {
+        uint8_t n = nRecent.load(std::memory_order_relaxed);
+        if (n < MAX_RECENT)
+            nRecent.store(n + 1, std::memory_order_relaxed);
+    }
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/** The number of independently locked partitions of the coins cache, see CCoinsViewCache */
+static const size_t COINS_CACHE_STRIPES = 32;
+
+/**
+ * With a large dbcache the coins cache holds tens of millions of entries, so it uses a flat open addressing table
+ * with pooled entries rather than a node per entry std::unordered_map.  Entries do not move while they are in the
+ * map, which CoinAccessor and _AccessCoin rely on.  The table is split into stripes by outpoint hash so that each
+ * stripe can have a lock of its own.
+ */
+typedef stripedflatmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, COINS_CACHE_STRIPES> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -163,6 +213,10 @@ public:
     //! Retrieve the Coin (unspent transaction output) for a given outpoint.
     virtual bool GetCoin(const COutPoint &outpoint, Coin &coin) const;
 
+    //! Retrieve the Coins for many outpoints at once.  coins[i] is the coin of outpoints[i], or a spent coin if
+    //! there is none.  Returns the number of coins found.  Views that can read in batches override this.
+    virtual size_t GetCoins(const std::vector<COutPoint> &outpoints, std::vector<Coin> &coins) const;
+
     //! Just check whether we have data for a given outpoint.
     //! This may (but cannot always) return true for spent outputs.
     virtual bool HaveCoin(const COutPoint &outpoint) const;
@@ -175,12 +229,16 @@ public:
         return _GetBestBlock();
     }
 
+    //! Retrieve the UTXO set commitment of the state this view represents.  Returns false if it is not known
+    virtual bool GetUtxoCommitment(CECMultiSet &commitment) const;
+
     //! Do a bulk modification (multiple Coin changes + BestBlock change).
-    //! The passed mapCoins can be modified.
+    //! The passed mapCoins can be modified.  commitmentDelta is the change to the UTXO set commitment.
     virtual bool BatchWrite(CCoinsMap &mapCoins,
         const uint256 &hashBlock,
         const uint64_t bestCoinHeight,
-        size_t &nChildCachedCoinsUsage);
+        size_t &nChildCachedCoinsUsage,
+        const CECMultiSet &commitmentDelta);
 
     //! Get a cursor to iterate over the whole state
     virtual CCoinsViewCursor *Cursor() const;
@@ -203,11 +261,13 @@ public:
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 _GetBestBlock() const override;
+    bool GetUtxoCommitment(CECMultiSet &commitment) const override;
     void SetBackend(CCoinsView &viewIn);
     bool BatchWrite(CCoinsMap &mapCoins,
         const uint256 &hashBlock,
         const uint64_t nBestCoinHeight,
-        size_t &nChildCachedCoinsUsage) override;
+        size_t &nChildCachedCoinsUsage,
+        const CECMultiSet &commitmentDelta) override;
     CCoinsViewCursor *Cursor() const override;
     size_t EstimateSize() const override;
 };
@@ -223,7 +283,6 @@ class CoinModifier
 {
 protected:
     const CCoinsViewCache *cache;
-    CCoinsMap::const_iterator it;
     const Coin *coin;
 
 public:
@@ -238,13 +297,13 @@ public:
 
 /**
  * A reference to an immutable cache entry.  This class holds the appropriate lock for you
- * while you access the underlying data.
+ * while you access the underlying data: cs_utxo shared, and the lock of the stripe the entry is in.
  */
 class CoinAccessor
 {
 protected:
     const CCoinsViewCache *cache;
-    CCoinsMap::const_iterator it;
+    const uint64_t hash;
     const Coin *coin;
     CDeferredSharedLocker lock;
 
@@ -259,7 +318,17 @@ public:
     friend class CCoinsViewCache;
 };
 
-/** CCoinsView that adds a memory cache for transactions to another CCoinsView */
+/**
+ * CCoinsView that adds a memory cache for transactions to another CCoinsView
+ *
+ * The cache is split into COINS_CACHE_STRIPES stripes by outpoint hash, each guarded by its own lock in csStripe,
+ * so that lookups, inserts and spends of coins in different stripes run concurrently.  The locking protocol is:
+ *  - operations on a single outpoint (GetCoin, HaveCoin, AddCoin, SpendCoin, Uncache, CoinAccessor...) take
+ *    cs_utxo shared and then the lock of the outpoint's stripe, shared to read or exclusive to modify the stripe.
+ *  - operations on the whole cache (Flush, BatchWrite, Trim, Clear, CoinModifier...) take cs_utxo exclusive, which
+ *    excludes every single outpoint operation, so they need no stripe locks and see a consistent view.
+ * A thread must never hold the locks of two stripes at once.
+ */
 class CCoinsViewCache : public CCoinsViewBacked
 {
     friend class CoinAccessor;
@@ -271,11 +340,21 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
-    mutable uint64_t nBestCoinHeight;
+    mutable std::atomic<uint64_t> nBestCoinHeight;
     mutable CCoinsMap cacheCoins;
-    mutable CSharedCriticalSection csCacheInsert;
+    mutable CSharedCriticalSection csStripe[COINS_CACHE_STRIPES];
+    /* The position of the eviction clock hand of Trim: a stripe, and a slot in that stripe. Guarded by cs_utxo */
+    mutable size_t nClockStripe;
+    mutable size_t nClockSlot;
     /* Cached dynamic memory usage for the inner Coin objects. */
-    mutable size_t cachedCoinsUsage;
+    mutable std::atomic<size_t> cachedCoinsUsage;
+    /* The change this cache makes to the UTXO set commitment of its base, kept per stripe so that it is guarded
+     * by the stripe locks like the coins themselves */
+    CECMultiSet commitmentDelta[COINS_CACHE_STRIPES];
+
+    CSharedCriticalSection &StripeLock(uint64_t hash) const { return csStripe[CCoinsMap::stripe_of(hash)]; }
+    CCoinsMap::stripe_type &Stripe(uint64_t hash) const { return cacheCoins.stripe(CCoinsMap::stripe_of(hash)); }
+    void UpdateBestCoinHeight(uint64_t nHeight) const;
 
 
 public:
@@ -290,7 +369,10 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins,
         const uint256 &hashBlock,
         const uint64_t nBestCoinHeight,
-        size_t &nChildCachedCoinsUsage);
+        size_t &nChildCachedCoinsUsage,
+        const CECMultiSet &commitmentDelta);
+    //! The commitment of the base with the changes in this cache applied
+    bool GetUtxoCommitment(CECMultiSet &commitment) const;
 
     /**
      * Check if we have the given utxo on disk and load it into cache.
@@ -299,6 +381,12 @@ public:
      */
     bool GetCoinFromDB(const COutPoint &outpoint) const;
 
+    /**
+     * Load the given utxos into cache with one batched read of the backing view.  Outpoints that are already
+     * in the cache are not read again.  Returns the number of unspent coins that were loaded.
+     */
+    size_t GetCoinsFromDB(const std::vector<COutPoint> &outpoints) const;
+
     /**
      * Check if we have the given utxo already loaded in this cache.
      *
@@ -312,7 +400,8 @@ public:
     /**
      * Return a reference to Coin in the cache, or a pruned one if not found. This is
      * more efficient than GetCoin. Modifications to other cache entries are
-     * allowed while accessing the returned pointer.
+     * allowed while accessing the returned pointer, but the coin itself is only safe to use while cs_utxo
+     * is held exclusively (or nothing else can modify it).
      */
     const Coin &_AccessCoin(const COutPoint &output) const;
 
@@ -343,13 +432,15 @@ public:
     {
         WRITELOCK(cs_utxo);
         cacheCoins.clear();
+        cachedCoinsUsage = 0;
     }
 
     /**
      * Remove excess entries from this cache.
-     * Entries are trimmed starting from the beginning of the map.  In this way if those entries
-     * are needed later they will all be collocated near the the beginning of the leveldb database
-     * and will be faster to retrieve.
+     * Clean entries are evicted by a CLOCK sweep over the cache: the hand ages every entry it passes, and evicts
+     * the ones that were not used since it last came around.  Entries that are used again and again survive
+     * several passes, so the working set of coins that are about to be spent stays in the cache.  The hand carries
+     * on from where the previous Trim left it.
      */
     void Trim(size_t nTrimSize) const;
 
@@ -396,9 +487,11 @@ public:
     double GetPriority(const CTransaction &tx, int nHeight, CAmount &inChainInputValue) const;
 
 protected:
-    // returns an iterator pointing to the coin and lock is taken (caller must unlock when finished with iterator)
-    // If lock is nullptr, the writelock must already be taken.
-    CCoinsMap::iterator FetchCoin(const COutPoint &outpoint, CDeferredSharedLocker *lock) const;
+    // Returns the cache entry of the outpoint, loading it from the base view if needed, or nullptr if there is none.
+    // hash is the hash of the outpoint in cacheCoins and lock is a locker on its stripe.  The stripe stays locked
+    // when this returns (the caller must unlock when finished with the entry).
+    // If lock is nullptr, the stripe or cs_utxo must already be locked exclusively.
+    CCoinsCacheEntry *FetchCoin(const COutPoint &outpoint, uint64_t hash, CDeferredSharedLocker *lock) const;
 
     /**
      * By making the copy constructor private, we prevent accidentally using it when one intends to create a cache on
@@ -407,6 +500,12 @@ protected:
     CCoinsViewCache(const CCoinsViewCache &);
 };
 
+/**
+ * Add a coin to (fAdd) or remove it from a UTXO set commitment.  The element committed to is the outpoint, the
+ * height and coinbase flag of the coin (as height * 2 + coinbase), and the output.
+ */
+void UpdateUtxoCommitment(CECMultiSet &commitment, const COutPoint &outpoint, const Coin &coin, bool fAdd);
+
 //! Utility function to add all of a transaction's outputs to a cache.
 // It assumes that overwrites are only possible for coinbase transactions,
 // TODO: pass in a boolean to limit these possible overwrites to known
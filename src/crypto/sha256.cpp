@@ -20,6 +20,16 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 #endif
 #endif
 
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+}
+
+namespace sha256d64_shani
+{
+void Transform_2way(unsigned char* out, const unsigned char* in);
+}
+
 namespace sha256d64_sse41
 {
 void Transform_4way(unsigned char* out, const unsigned char* in);
@@ -474,8 +484,24 @@ bool SelfTest(TransformType tr) {
     return true;
 }
 
+/** Check a multi-way double-SHA256 against the generic implementation. */
+bool SelfTestD64(TransformD64Type tr, size_t ways)
+{
+    unsigned char in[64 * 8];
+    unsigned char out[32 * 8];
+    unsigned char expected[32];
+    for (size_t i = 0; i < sizeof(in); i++) in[i] = (unsigned char)(i * 7 + 3);
+    tr(out, in);
+    for (size_t i = 0; i < ways; i++) {
+        sha256::TransformD64(expected, in + 64 * i);
+        if (memcmp(out + 32 * i, expected, 32)) return false;
+    }
+    return true;
+}
+
 TransformType Transform = sha256::Transform;
 TransformD64Type TransformD64 = sha256::TransformD64;
+TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
 
@@ -511,11 +537,26 @@ std::string SHA256AutoDetect()
 #endif
 #else
         ret = "sse4";
+#endif
+#if defined(ENABLE_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
+        // The SHA extensions beat every other single and 2-way implementation, so they replace the 1-way
+        // transform.  The wider SSE4.1/AVX2 paths remain in use for batches of 4 or 8 hashes.
+        cpuid(7, 0, eax, ebx, ecx, edx);
+        if ((ebx >> 29) & 1) {
+            Transform = sha256_shani::Transform;
+            TransformD64 = TransformD64Wrapper<sha256_shani::Transform>;
+            TransformD64_2way = sha256d64_shani::Transform_2way;
+            ret += ",shani(1way+2way)";
+        }
 #endif
     }
 #endif
 
     assert(SelfTest(Transform));
+    assert(SelfTestD64(TransformD64, 1));
+    assert(!TransformD64_2way || SelfTestD64(TransformD64_2way, 2));
+    assert(!TransformD64_4way || SelfTestD64(TransformD64_4way, 4));
+    assert(!TransformD64_8way || SelfTestD64(TransformD64_8way, 8));
     return ret;
 }
 
@@ -594,6 +635,14 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
             blocks -= 4;
         }
     }
+    if (TransformD64_2way) {
+        while (blocks >= 2) {
+            TransformD64_2way(out, in);
+            out += 64;
+            in += 128;
+            blocks -= 2;
+        }
+    }
     while (blocks) {
         TransformD64(out, in);
         out += 32;
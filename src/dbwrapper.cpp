@@ -8,6 +8,7 @@
 #include "fs.h"
 #include "random.h"
 #include "util.h"
+#include "workerpool.h"
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -15,6 +16,7 @@
 #include <memenv.h>
 #include <stdint.h>
 
+
 static void SetMaxOpenFiles(leveldb::Options *options)
 {
     // On most platforms the default setting of max_open_files (which is 1000)
@@ -155,6 +157,64 @@ bool CDBWrapper::WriteBatch(CDBBatch &batch, bool fSync)
     return true;
 }
 
+// Walk keys[begin, end) with one iterator.  The keys are sorted, so the iterator only moves forward and keys that
+// are next to each other in the database are found without another seek.
+static void ReadSortedRange(leveldb::DB *pdb,
+    const leveldb::ReadOptions &options,
+    const std::vector<std::string> &keys,
+    size_t begin,
+    size_t end,
+    const std::function<void(size_t, const leveldb::Slice &)> &fn)
+{
+    std::unique_ptr<leveldb::Iterator> it(pdb->NewIterator(options));
+    for (size_t i = begin; i < end; i++)
+    {
+        leveldb::Slice slKey(keys[i]);
+        if (!it->Valid() || it->key().compare(slKey) < 0)
+        {
+            it->Seek(slKey);
+            if (!it->Valid())
+            {
+                // Every key that is left is past the end of the database
+                dbwrapper_private::HandleError(it->status());
+                return;
+            }
+        }
+        if (it->key() == slKey)
+            fn(i, it->value());
+    }
+    dbwrapper_private::HandleError(it->status());
+}
+
+void CDBWrapper::ReadSorted(const std::vector<std::string> &keys,
+    const std::function<void(size_t, const leveldb::Slice &)> &fn,
+    unsigned int nThreads) const
+{
+    if (keys.empty())
+        return;
+
+    // Every range must see the same state of the database
+    leveldb::ReadOptions snapshotoptions = readoptions;
+    snapshotoptions.snapshot = pdb->GetSnapshot();
+
+    const size_t nRanges = std::max<size_t>(1, std::min<size_t>(nThreads, keys.size() / MIN_KEYS_PER_READ_THREAD));
+    const size_t nPerRange = (keys.size() + nRanges - 1) / nRanges;
+    try
+    {
+        GetWorkerPool().ForEach(nRanges, [this, &snapshotoptions, &keys, &fn, nPerRange](size_t n) {
+            const size_t begin = std::min(keys.size(), n * nPerRange);
+            const size_t end = std::min(keys.size(), begin + nPerRange);
+            ReadSortedRange(pdb, snapshotoptions, keys, begin, end, fn);
+        });
+    }
+    catch (...)
+    {
+        pdb->ReleaseSnapshot(snapshotoptions.snapshot);
+        throw;
+    }
+    pdb->ReleaseSnapshot(snapshotoptions.snapshot);
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
@@ -181,6 +241,20 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+CDBIterator *CDBWrapper::NewIterator(std::shared_ptr<const leveldb::Snapshot> snapshot) const
+{
+    leveldb::ReadOptions snapshotoptions = iteroptions;
+    snapshotoptions.snapshot = snapshot.get();
+    return new CDBIterator(*this, pdb->NewIterator(snapshotoptions), std::move(snapshot));
+}
+
+std::shared_ptr<const leveldb::Snapshot> CDBWrapper::GetSnapshot() const
+{
+    leveldb::DB *db = pdb;
+    return std::shared_ptr<const leveldb::Snapshot>(
+        pdb->GetSnapshot(), [db](const leveldb::Snapshot *snapshot) { db->ReleaseSnapshot(snapshot); });
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() const { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
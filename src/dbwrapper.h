@@ -14,11 +14,17 @@
 #include "utilstrencodings.h"
 #include "version.h"
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
+//! Batched reads of fewer keys than this per thread are not worth splitting across threads
+static const size_t MIN_KEYS_PER_READ_THREAD = 256;
 
 // DBWrapper leveldb options that can be modified rather than using the defaults defined in GetDefaultOptions().
 struct COverrideOptions
@@ -135,13 +141,19 @@ class CDBIterator
 private:
     const CDBWrapper &parent;
     leveldb::Iterator *piter;
+    //! The snapshot that the iterator reads, if it was created on one.  It is released after the iterator
+    std::shared_ptr<const leveldb::Snapshot> snapshot;
 
 public:
     /**
      * @param[in] _parent          Parent CDBWrapper instance.
      * @param[in] _piter           The original leveldb iterator.
+     * @param[in] _snapshot        The snapshot that _piter reads, if any.
      */
-    CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter) : parent(_parent), piter(_piter){};
+    CDBIterator(const CDBWrapper &_parent,
+        leveldb::Iterator *_piter,
+        std::shared_ptr<const leveldb::Snapshot> _snapshot = nullptr)
+        : parent(_parent), piter(_piter), snapshot(std::move(_snapshot)){};
     ~CDBIterator();
 
     bool Valid() const;
@@ -300,6 +312,71 @@ public:
         return true;
     }
 
+    /**
+     * Read the values of many keys at once.  The keys are sorted and then walked in key order by one iterator,
+     * on one snapshot of the database, so neighbouring keys share the index lookups and block reads that separate
+     * Gets would each repeat.  With nThreads > 1 large reads are split into up to nThreads ranges of keys that are
+     * walked in parallel on the shared worker pool, still on the same snapshot.  values[i] is the value of keys[i] if found[i], and default
+     * constructed otherwise.  Returns the number of keys found.
+     */
+    template <typename K, typename V>
+    size_t ReadMany(const std::vector<K> &keys,
+        std::vector<V> &values,
+        std::vector<bool> &found,
+        unsigned int nThreads = 1) const
+    {
+        std::vector<std::pair<std::string, size_t> > sorted(keys.size());
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+            ssKey << keys[i];
+            sorted[i].first.assign(ssKey.data(), ssKey.size());
+            sorted[i].second = i;
+        }
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<std::string> sortedKeys(sorted.size());
+        for (size_t i = 0; i < sorted.size(); i++)
+            sortedKeys[i].swap(sorted[i].first);
+
+        values.assign(keys.size(), V());
+        // Written from several threads, so not a vector<bool>
+        std::unique_ptr<char[]> fFound(new char[keys.size()]());
+        ReadSorted(sortedKeys,
+            [this, &sorted, &values, &fFound](size_t i, const leveldb::Slice &slValue) {
+                const size_t n = sorted[i].second;
+                try
+                {
+                    CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+                    ssValue.Xor(obfuscate_key);
+                    ssValue >> values[n];
+                    fFound[n] = 1;
+                }
+                catch (const std::exception &)
+                {
+                    values[n] = V();
+                }
+            },
+            nThreads);
+
+        size_t nFound = 0;
+        found.assign(keys.size(), false);
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            found[i] = fFound[i];
+            nFound += fFound[i];
+        }
+        return nFound;
+    }
+
+    /**
+     * Walk sorted serialized keys, calling fn with the position and the value of every key that is found.  fn may
+     * be called from several threads at once when nThreads > 1.  See ReadMany.
+     */
+    void ReadSorted(const std::vector<std::string> &keys,
+        const std::function<void(size_t, const leveldb::Slice &)> &fn,
+        unsigned int nThreads) const;
+
     template <typename K>
     bool Exists(const K &key) const
     {
@@ -326,6 +403,10 @@ public:
     }
 
     CDBIterator *NewIterator() { return new CDBIterator(*this, pdb->NewIterator(iteroptions)); }
+    //! An iterator over a snapshot, so that several iterators can read the same state while the database is written
+    CDBIterator *NewIterator(std::shared_ptr<const leveldb::Snapshot> snapshot) const;
+    //! A consistent view of the database, which is released when the last reference to it goes away
+    std::shared_ptr<const leveldb::Snapshot> GetSnapshot() const;
     /**
      * Return true if the database managed by this class contains no entries.
      */
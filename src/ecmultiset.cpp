@@ -0,0 +1,40 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ecmultiset.h"
+
+#include <secp256k1.h>
+
+#include <algorithm>
+
+// The multiset functions do not use any precomputed tables, so they can all share the static context
+CECMultiSet::CECMultiSet() { SetEmpty(); }
+void CECMultiSet::Add(const unsigned char *data, size_t len)
+{
+    secp256k1_multiset_add(secp256k1_context_no_precomp, &ms, data, len);
+}
+
+void CECMultiSet::Remove(const unsigned char *data, size_t len)
+{
+    secp256k1_multiset_remove(secp256k1_context_no_precomp, &ms, data, len);
+}
+
+void CECMultiSet::Combine(const CECMultiSet &other)
+{
+    secp256k1_multiset_combine(secp256k1_context_no_precomp, &ms, &other.ms);
+}
+
+void CECMultiSet::SetEmpty() { secp256k1_multiset_init(secp256k1_context_no_precomp, &ms); }
+bool CECMultiSet::IsEmpty() const
+{
+    // The empty set is the point at infinity, which has z == 0
+    return std::all_of(ms.d + 64, ms.d + 96, [](unsigned char c) { return c == 0; });
+}
+
+uint256 CECMultiSet::GetHash() const
+{
+    uint256 hash;
+    secp256k1_multiset_finalize(secp256k1_context_no_precomp, hash.begin(), &ms);
+    return hash;
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ECMULTISET_H
+#define BITCOIN_ECMULTISET_H
+
+#include "uint256.h"
+
+#include <secp256k1_multiset.h>
+
+#include <stddef.h>
+
+/**
+ * An elliptic curve multiset hash (ECMH).
+ *
+ * Every element is hashed to a point on the secp256k1 curve and the multiset is the sum of those points, so
+ * elements can be added and removed in any order, and two multisets can be combined, in constant time.  The
+ * hash of a multiset only depends on which elements are in it.  An empty multiset hashes to zero.
+ */
+class CECMultiSet
+{
+    secp256k1_multiset ms;
+
+public:
+    CECMultiSet();
+
+    //! Add an element
+    void Add(const unsigned char *data, size_t len);
+    //! Remove an element.  Removing an element that is not in the set is allowed: a later Add cancels it out
+    void Remove(const unsigned char *data, size_t len);
+    //! Add every element of another multiset (with its removals)
+    void Combine(const CECMultiSet &other);
+    void SetEmpty();
+    bool IsEmpty() const;
+
+    uint256 GetHash() const;
+
+    template <typename Stream>
+    void Serialize(Stream &s) const
+    {
+        s.write((const char *)ms.d, sizeof(ms.d));
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream &s)
+    {
+        s.read((char *)ms.d, sizeof(ms.d));
+    }
+};
+
+#endif
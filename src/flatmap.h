@@ -0,0 +1,643 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_FLATMAP_H
+#define BITCOIN_FLATMAP_H
+
+#include "memusage.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * An open addressing hash map, for maps with very many small entries such as the coins cache.
+ *
+ * std::unordered_map allocates every entry separately and chains the entries of a bucket through a linked list,
+ * so a lookup chases several pointers to randomly placed heap blocks, and every insert and erase is a trip
+ * through the allocator.  Here the table is a flat array of slots, each holding the full hash of its key and a
+ * pointer to the entry.  Collisions are resolved by linear probing, so a lookup walks consecutive slots and only
+ * dereferences an entry whose hash matches.  The entries themselves are carved out of large chunks owned by the
+ * map and recycled through a free list.
+ *
+ * The interface is the subset of std::unordered_map's that the coins code uses, with the same guarantees:
+ * - references and pointers to entries stay valid until the entry is erased (entries never move, even when the
+ *   table grows)
+ * - erase() only invalidates iterators to the erased entry, so the map can be pruned while it is iterated
+ * - an insert may invalidate all iterators
+ *
+ * Erased slots are left as tombstones so that erasing never moves other slots.  Tombstones are dropped when the
+ * table is rebuilt.
+ */
+template <typename K, typename T, typename Hash = std::hash<K>, typename Pred = std::equal_to<K> >
+class flatmap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+    typedef Hash hasher;
+    typedef Pred key_equal;
+
+private:
+    /** Storage for one entry.  While the entry is not in use it links the pool's free list */
+    union Node
+    {
+        Node *nextFree;
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+
+        value_type *value() { return reinterpret_cast<value_type *>(&storage); }
+    };
+
+    struct Slot
+    {
+        uint64_t hash;
+        Node *node; // nullptr if the slot was never used, TOMBSTONE if its entry was erased
+    };
+
+    // Nodes are at least pointer aligned, so this can never be the address of a real node
+    static Node *Tombstone() { return reinterpret_cast<Node *>(uintptr_t(1)); }
+    static bool IsLive(const Slot &slot) { return slot.node != nullptr && slot.node != Tombstone(); }
+
+    /** Chunk allocator for the entries.  Chunks grow geometrically so that small maps stay small */
+    class Pool
+    {
+        enum
+        {
+            MIN_CHUNK = 32,
+            MAX_CHUNK = 16384
+        };
+
+        std::vector<std::unique_ptr<Node[]> > chunks;
+        Node *freeList = nullptr;
+        size_t nextChunk = MIN_CHUNK;
+        size_t nCapacity = 0;
+        size_t nUsage = 0;
+
+    public:
+        Node *alloc()
+        {
+            if (freeList == nullptr)
+            {
+                Node *chunk = new Node[nextChunk];
+                chunks.emplace_back(chunk);
+                for (size_t i = 0; i < nextChunk; i++)
+                    chunk[i].nextFree = (i + 1 < nextChunk) ? &chunk[i + 1] : nullptr;
+                freeList = chunk;
+                nCapacity += nextChunk;
+                nUsage += memusage::MallocUsage(sizeof(Node) * nextChunk);
+                nextChunk = std::min<size_t>(nextChunk * 2, MAX_CHUNK);
+            }
+            Node *node = freeList;
+            freeList = node->nextFree;
+            return node;
+        }
+
+        void free(Node *node)
+        {
+            node->nextFree = freeList;
+            freeList = node;
+        }
+
+        /** Give all the memory back.  Only call this when no node is in use */
+        void release()
+        {
+            chunks.clear();
+            freeList = nullptr;
+            nextChunk = MIN_CHUNK;
+            nCapacity = 0;
+            nUsage = 0;
+        }
+
+        size_t capacity() const { return nCapacity; }
+        size_t usage() const { return nUsage; }
+    };
+
+    enum
+    {
+        MIN_SLOTS = 16
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t nSlots = 0; // always 0 or a power of 2
+    size_t nSize = 0;
+    size_t nUsed = 0; // live entries plus tombstones
+    Pool pool;
+    Hash hash_function;
+    Pred key_eq;
+
+    uint64_t hash_of(const K &key) const { return static_cast<uint64_t>(hash_function(key)); }
+    /** Find the slot of key, or nullptr */
+    Slot *find_slot(const K &key, uint64_t hash) const
+    {
+        if (nSlots == 0)
+            return nullptr;
+        const size_t mask = nSlots - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            Slot &slot = slots[i];
+            if (slot.node == nullptr)
+                return nullptr;
+            if (slot.hash == hash && slot.node != Tombstone() && key_eq(slot.node->value()->first, key))
+                return &slot;
+        }
+    }
+
+    /** Place a node in the first free slot of its probe sequence.  The key must not be in the map */
+    Slot *place(Node *node, uint64_t hash)
+    {
+        const size_t mask = nSlots - 1;
+        size_t i = hash & mask;
+        while (IsLive(slots[i]))
+            i = (i + 1) & mask;
+        if (slots[i].node == nullptr)
+            nUsed++;
+        slots[i].hash = hash;
+        slots[i].node = node;
+        nSize++;
+        return &slots[i];
+    }
+
+    /** Rebuild the table with enough room for one more entry, dropping the tombstones */
+    void rehash()
+    {
+        size_t nNewSlots = std::max<size_t>(nSlots, MIN_SLOTS);
+        // Keep the load below 1/2 after rebuilding, so the table stays below 3/4 until the next rebuild
+        while ((nSize + 1) * 2 > nNewSlots)
+            nNewSlots *= 2;
+
+        std::unique_ptr<Slot[]> old(std::move(slots));
+        const size_t nOldSlots = nSlots;
+        slots.reset(new Slot[nNewSlots]());
+        nSlots = nNewSlots;
+        nSize = 0;
+        nUsed = 0;
+        for (size_t i = 0; i < nOldSlots; i++)
+        {
+            if (IsLive(old[i]))
+                place(old[i].node, old[i].hash);
+        }
+    }
+
+    void destroy(Node *node)
+    {
+        node->value()->~value_type();
+        pool.free(node);
+    }
+
+    template <typename... Args>
+    Node *make_node(Args &&... args)
+    {
+        Node *node = pool.alloc();
+        try
+        {
+            new (node->value()) value_type(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            pool.free(node);
+            throw;
+        }
+        return node;
+    }
+
+    /** Insert a constructed node, unless its key is already in the map.  In that case the node is destroyed */
+    std::pair<Slot *, bool> insert_node(Node *node, uint64_t hash)
+    {
+        Slot *slot = find_slot(node->value()->first, hash);
+        if (slot)
+        {
+            destroy(node);
+            return std::make_pair(slot, false);
+        }
+        if ((nUsed + 1) * 4 > nSlots * 3)
+            rehash();
+        return std::make_pair(place(node, hash), true);
+    }
+
+    template <bool IsConst>
+    class Iterator
+    {
+        friend class flatmap;
+        friend class Iterator<!IsConst>;
+        typedef typename std::conditional<IsConst, const Slot *, Slot *>::type SlotPtr;
+        SlotPtr slot = nullptr;
+        SlotPtr slotsEnd = nullptr;
+
+        Iterator(SlotPtr slotIn, SlotPtr endIn) : slot(slotIn), slotsEnd(endIn) { skip(); }
+        void skip()
+        {
+            while (slot != slotsEnd && !IsLive(*slot))
+                slot++;
+        }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename flatmap::value_type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef typename std::conditional<IsConst, const value_type *, value_type *>::type pointer;
+        typedef typename std::conditional<IsConst, const value_type &, value_type &>::type reference;
+
+        Iterator() {}
+        // Allow the conversion of an iterator into a const_iterator, but not the other way around
+        template <bool WasConst, typename = typename std::enable_if<IsConst && !WasConst>::type>
+        Iterator(const Iterator<WasConst> &other) : slot(other.slot), slotsEnd(other.slotsEnd)
+        {
+        }
+
+        reference operator*() const { return *slot->node->value(); }
+        pointer operator->() const { return slot->node->value(); }
+        Iterator &operator++()
+        {
+            slot++;
+            skip();
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            Iterator ret = *this;
+            ++(*this);
+            return ret;
+        }
+
+        template <bool OtherConst>
+        bool operator==(const Iterator<OtherConst> &other) const
+        {
+            return slot == other.slot;
+        }
+        template <bool OtherConst>
+        bool operator!=(const Iterator<OtherConst> &other) const
+        {
+            return slot != other.slot;
+        }
+    };
+
+public:
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+
+    flatmap() {}
+    flatmap(const flatmap &) = delete;
+    flatmap &operator=(const flatmap &) = delete;
+    ~flatmap() { clear(); }
+    iterator begin() { return iterator(slots.get(), slots.get() + nSlots); }
+    iterator end() { return iterator(slots.get() + nSlots, slots.get() + nSlots); }
+    const_iterator begin() const { return const_iterator(slots.get(), slots.get() + nSlots); }
+    const_iterator end() const { return const_iterator(slots.get() + nSlots, slots.get() + nSlots); }
+    size_type size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+    iterator find(const K &key)
+    {
+        Slot *slot = find_slot(key, hash_of(key));
+        return slot ? iterator(slot, slots.get() + nSlots) : end();
+    }
+
+    const_iterator find(const K &key) const
+    {
+        const Slot *slot = find_slot(key, hash_of(key));
+        return slot ? const_iterator(slot, slots.get() + nSlots) : end();
+    }
+
+    size_type count(const K &key) const { return find_slot(key, hash_of(key)) ? 1 : 0; }
+    /** Construct an entry from args.  Like std::unordered_map, nothing is inserted if the key is already there */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args &&... args)
+    {
+        Node *node = make_node(std::forward<Args>(args)...);
+        std::pair<Slot *, bool> ret = insert_node(node, hash_of(node->value()->first));
+        return std::make_pair(iterator(ret.first, slots.get() + nSlots), ret.second);
+    }
+
+    /**
+     * The hashed interface: the same operations for a caller that has already hashed the key with hash_key(), so
+     * that a key is hashed only once however many lookups it takes.  See stripedflatmap.
+     */
+    uint64_t hash_key(const K &key) const { return hash_of(key); }
+    iterator find(const K &key, uint64_t hash)
+    {
+        Slot *slot = find_slot(key, hash);
+        return slot ? iterator(slot, slots.get() + nSlots) : end();
+    }
+
+    const_iterator find(const K &key, uint64_t hash) const
+    {
+        const Slot *slot = find_slot(key, hash);
+        return slot ? const_iterator(slot, slots.get() + nSlots) : end();
+    }
+
+    /** Like emplace().  hash must be the hash of the key the entry is constructed with */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace_hashed(uint64_t hash, Args &&... args)
+    {
+        std::pair<Slot *, bool> ret = insert_node(make_node(std::forward<Args>(args)...), hash);
+        return std::make_pair(iterator(ret.first, slots.get() + nSlots), ret.second);
+    }
+
+    /**
+     * Positions in the slot table, so that a walk over the map can be stopped and resumed later (see
+     * CCoinsViewCache::Trim).  A position keeps its meaning until the table is rehashed, which only an insert does.
+     */
+    size_t slot_index(const_iterator it) const { return it.slot - slots.get(); }
+    iterator from_slot(size_t n) { return iterator(slots.get() + std::min(n, nSlots), slots.get() + nSlots); }
+    size_type erase(const K &key, uint64_t hash)
+    {
+        const_iterator it = find(key, hash);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
+
+    std::pair<iterator, bool> insert(const value_type &value) { return emplace(value); }
+    std::pair<iterator, bool> insert(value_type &&value) { return emplace(std::move(value)); }
+    T &operator[](const K &key)
+    {
+        iterator it = find(key);
+        if (it != end())
+            return it->second;
+        return emplace(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>()).first->second;
+    }
+
+    /** Erase the entry at pos.  Returns an iterator to the next entry */
+    iterator erase(const_iterator pos)
+    {
+        Slot *slot = const_cast<Slot *>(pos.slot);
+        assert(IsLive(*slot));
+        destroy(slot->node);
+        slot->node = Tombstone();
+        nSize--;
+        // Nothing is left, so the chunks can go back to the system.  The slots stay, as pos may still be in use
+        if (nSize == 0)
+            pool.release();
+        return iterator(slot + 1, slots.get() + nSlots);
+    }
+
+    size_type erase(const K &key)
+    {
+        const_iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < nSlots; i++)
+        {
+            if (IsLive(slots[i]))
+                slots[i].node->value()->~value_type();
+        }
+        slots.reset();
+        nSlots = 0;
+        nSize = 0;
+        nUsed = 0;
+        pool.release();
+    }
+
+    /**
+     * Heap memory used by the map, not counting any memory owned by the entries.  This includes all the chunks of
+     * the entry pool: erasing an entry puts it on the free list for the next insert, it does not give the memory
+     * back until the map is empty.
+     */
+    size_t DynamicMemoryUsage() const
+    {
+        return pool.usage() + (nSlots ? memusage::MallocUsage(sizeof(Slot) * nSlots) : 0);
+    }
+
+    /** The part of DynamicMemoryUsage() taken by erased entries waiting on the free list */
+    size_t FreeMemoryUsage() const { return sizeof(Node) * (pool.capacity() - nSize); }
+
+    /** Number of entries the pool can hold without allocating */
+    size_t pool_capacity() const { return pool.capacity(); }
+    /** Number of slots in the table */
+    size_t bucket_count() const { return nSlots; }
+};
+
+/**
+ * A flatmap split into STRIPES independent maps by the hash of the key, so that each stripe can be
+ * guarded by a lock of its own (see CCoinsViewCache).  Callers that work on a single stripe hash the key once with
+ * hash_key(), pick the stripe with stripe_of() and use the hashed interface of the stripe.  The rest of the
+ * interface treats the stripes as one map; iterating visits the stripes in turn.
+ */
+template <typename K, typename T, typename Hash, size_t STRIPES>
+class stripedflatmap
+{
+    static_assert(STRIPES > 0 && (STRIPES & (STRIPES - 1)) == 0, "the number of stripes must be a power of 2");
+
+    static constexpr unsigned int Log2(size_t n) { return n <= 1 ? 0 : 1 + Log2(n / 2); }
+    static constexpr unsigned int STRIPE_BITS = Log2(STRIPES);
+    static_assert(STRIPE_BITS <= 32, "too many stripes");
+
+    /** The stripes are only used through their hashed interface, so they do not need a hasher of their own */
+    struct PrehashedKey
+    {
+        uint64_t operator()(const K &) const
+        {
+            assert(!"a stripe of a stripedflatmap must be given the hash of the key");
+            return 0;
+        }
+    };
+
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+    typedef flatmap<K, T, PrehashedKey> stripe_type;
+
+private:
+    Hash hash_function;
+    stripe_type stripes[STRIPES];
+
+    template <bool IsConst>
+    class Iterator
+    {
+        friend class stripedflatmap;
+        friend class Iterator<!IsConst>;
+        typedef typename std::conditional<IsConst, const stripedflatmap *, stripedflatmap *>::type MapPtr;
+        typedef typename std::conditional<IsConst, typename stripe_type::const_iterator,
+            typename stripe_type::iterator>::type StripeIterator;
+        MapPtr map = nullptr;
+        size_t stripe = STRIPES;
+        StripeIterator it;
+
+        Iterator(MapPtr mapIn, size_t stripeIn, StripeIterator itIn) : map(mapIn), stripe(stripeIn), it(itIn)
+        {
+            skip();
+        }
+        void skip()
+        {
+            while (stripe < STRIPES && it == map->stripes[stripe].end())
+            {
+                if (++stripe < STRIPES)
+                    it = map->stripes[stripe].begin();
+            }
+        }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename stripedflatmap::value_type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef typename std::conditional<IsConst, const value_type *, value_type *>::type pointer;
+        typedef typename std::conditional<IsConst, const value_type &, value_type &>::type reference;
+
+        Iterator() {}
+        template <bool WasConst, typename = typename std::enable_if<IsConst && !WasConst>::type>
+        Iterator(const Iterator<WasConst> &other) : map(other.map), stripe(other.stripe), it(other.it)
+        {
+        }
+
+        reference operator*() const { return *it; }
+        pointer operator->() const { return &*it; }
+        Iterator &operator++()
+        {
+            ++it;
+            skip();
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            Iterator ret = *this;
+            ++(*this);
+            return ret;
+        }
+
+        template <bool OtherConst>
+        bool operator==(const Iterator<OtherConst> &other) const
+        {
+            return stripe == other.stripe && (stripe == STRIPES || it == other.it);
+        }
+        template <bool OtherConst>
+        bool operator!=(const Iterator<OtherConst> &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+public:
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+
+    uint64_t hash_key(const K &key) const { return static_cast<uint64_t>(hash_function(key)); }
+    /**
+     * The stripe of a key, given its hash.  The stripes use the low bits of the hash for their own tables, and on
+     * 32 bit builds the high bits are always 0, so the stripe is taken from the top bits of a multiplicative mix
+     * of the whole hash.
+     */
+    static size_t stripe_of(uint64_t hash) { return (hash * 0x9E3779B97F4A7C15ULL) >> 32 >> (32 - STRIPE_BITS); }
+    stripe_type &stripe(size_t n) { return stripes[n]; }
+    const stripe_type &stripe(size_t n) const { return stripes[n]; }
+    iterator begin() { return iterator(this, 0, stripes[0].begin()); }
+    iterator end() { return iterator(this, STRIPES, typename stripe_type::iterator()); }
+    const_iterator begin() const { return const_iterator(this, 0, stripes[0].begin()); }
+    const_iterator end() const { return const_iterator(this, STRIPES, typename stripe_type::const_iterator()); }
+    size_type size() const
+    {
+        size_type ret = 0;
+        for (const stripe_type &s : stripes)
+            ret += s.size();
+        return ret;
+    }
+
+    bool empty() const { return size() == 0; }
+    iterator find(const K &key)
+    {
+        const uint64_t hash = hash_key(key);
+        const size_t n = stripe_of(hash);
+        typename stripe_type::iterator it = stripes[n].find(key, hash);
+        return it == stripes[n].end() ? end() : iterator(this, n, it);
+    }
+
+    const_iterator find(const K &key) const
+    {
+        const uint64_t hash = hash_key(key);
+        const size_t n = stripe_of(hash);
+        typename stripe_type::const_iterator it = stripes[n].find(key, hash);
+        return it == stripes[n].end() ? end() : const_iterator(this, n, it);
+    }
+
+    size_type count(const K &key) const { return find(key) == end() ? 0 : 1; }
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args &&... args)
+    {
+        // The key is needed to pick the stripe, so the entry is built here and moved into its stripe
+        value_type value(std::forward<Args>(args)...);
+        const uint64_t hash = hash_key(value.first);
+        const size_t n = stripe_of(hash);
+        std::pair<typename stripe_type::iterator, bool> ret = stripes[n].emplace_hashed(hash, std::move(value));
+        return std::make_pair(iterator(this, n, ret.first), ret.second);
+    }
+
+    T &operator[](const K &key)
+    {
+        const uint64_t hash = hash_key(key);
+        const size_t n = stripe_of(hash);
+        typename stripe_type::iterator it = stripes[n].find(key, hash);
+        if (it != stripes[n].end())
+            return it->second;
+        return stripes[n]
+            .emplace_hashed(hash, std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>())
+            .first->second;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        typename stripe_type::iterator next = stripes[pos.stripe].erase(pos.it);
+        return iterator(this, pos.stripe, next);
+    }
+
+    size_type erase(const K &key)
+    {
+        const uint64_t hash = hash_key(key);
+        return stripes[stripe_of(hash)].erase(key, hash);
+    }
+
+    void clear()
+    {
+        for (stripe_type &s : stripes)
+            s.clear();
+    }
+
+    size_t DynamicMemoryUsage() const
+    {
+        size_t ret = 0;
+        for (const stripe_type &s : stripes)
+            ret += s.DynamicMemoryUsage();
+        return ret;
+    }
+
+    size_t FreeMemoryUsage() const
+    {
+        size_t ret = 0;
+        for (const stripe_type &s : stripes)
+            ret += s.FreeMemoryUsage();
+        return ret;
+    }
+};
+
+namespace memusage
+{
+template <typename K, typename T, typename H, typename P>
+static inline size_t DynamicUsage(const flatmap<K, T, H, P> &m)
+{
+    return m.DynamicMemoryUsage();
+}
+
+template <typename K, typename T, typename H, size_t N>
+static inline size_t DynamicUsage(const stripedflatmap<K, T, H, N> &m)
+{
+    return m.DynamicMemoryUsage();
+}
+}
+
+#endif // BITCOIN_FLATMAP_H
@@ -242,18 +242,11 @@ deque<CNodeRef> vPrioritySendQ GUARDED_BY(cs_prioritySendQ);
 
 // Transaction mempool admission globals
 
-// Transactions that are available to be added to the mempool, and protection
-CCriticalSection csTxInQ;
-CCond cvTxInQ;
-
-// Finds transactions that may conflict with other pending transactions
-CFastFilter<4 * 1024 * 1024> incomingConflicts GUARDED_BY(csTxInQ);
-
 // Tranactions that are waiting for validation and are known not to conflict with others
-std::queue<CTxInputData> txInQ GUARDED_BY(csTxInQ);
+CTxAdmissionShards txInQ;
 
 // Transaction that cannot be processed in this round (may potentially conflict with other tx)
-std::queue<CTxInputData> txDeferQ GUARDED_BY(csTxInQ);
+CLockFreeQueue<CTxInputData> txDeferQ(TXADMISSION_QUEUE_SIZE);
 
 
 // Transactions that have been validated and are waiting to be committed into the mempool
@@ -504,6 +497,15 @@ CTweak<double> grapheneBloomFprOverride("net.grapheneBloomFprOverride",
     "Override size of Bloom filter to the indicated value (greater than 0.0): 0.0 for optimal (default: 0.0)",
     0.0);
 
+/** Graphene blocks for a peer are sized from how the earlier ones decoded there, weighing the bytes of a larger IBLT
+ * and Bloom filter against the cost of a failure recovery, which is this many bytes plus those of its messages.
+ */
+CTweak<uint64_t> grapheneRoundTripCost("net.grapheneRoundTripCost",
+    strprintf("Cost in bytes of a graphene failure recovery round trip, against which the sizes of graphene blocks for "
+              "each peer are chosen: 0 to not size them from how earlier ones decoded (default: %d)",
+        DEFAULT_GRAPHENE_ROUND_TRIP_COST),
+    DEFAULT_GRAPHENE_ROUND_TRIP_COST);
+
 CTweak<bool> syncMempoolWithPeers("net.syncMempoolWithPeers", "Synchronize mempool with peers (default: false)", false);
 
 /** This setting specifies the minimum supported mempool sync version (inclusive).
@@ -598,6 +600,17 @@ CStatHistory<uint64_t> sendAmt;
 CStatHistory<uint64_t> nTxValidationTime("txValidationTime", STAT_OP_MAX | STAT_INDIVIDUAL);
 CCriticalSection cs_blockvalidationtime;
 CStatHistory<uint64_t> nBlockValidationTime("blockValidationTime", STAT_OP_MAX | STAT_INDIVIDUAL);
+// The sizing of graphene blocks from how the earlier ones decoded at each peer, see CGrapheneBlockData::GetPeerTuning
+CStatHistory<uint64_t> grapheneModelIbltPadding("graphene/model/ibltPadding", STAT_OP_AVE);
+CStatHistory<double> grapheneModelFprScale("graphene/model/fprScale", STAT_OP_AVE);
+CStatHistory<uint64_t> grapheneModelMissingTxs("graphene/model/missingTxs", STAT_OP_AVE);
+CStatHistory<uint64_t> grapheneModelDecodeFailures("graphene/model/decodeFailures");
+CStatHistory<uint64_t> grapheneModelRecoveryBytes("graphene/model/recoveryBytes", STAT_OP_AVE);
+CStatHistory<uint64_t, MinValMax<uint64_t> > txInQDepth; // "txAdmission/inQ/depth", STAT_OP_AVE
+CStatHistory<uint64_t, MinValMax<uint64_t> > txDeferQDepth; // "txAdmission/deferQ/depth", STAT_OP_AVE
+CStatHistory<uint64_t> txEnqueueLatency; // "txAdmission/enqueueLatency", STAT_OP_AVE
+CStatHistory<uint64_t> txDequeueLatency; // "txAdmission/dequeueLatency", STAT_OP_AVE
+CStatHistory<uint64_t> txAdmissionDropped; // "txAdmission/dropped"
 
 // Single classes for gather thin type block relay statistics
 CThinBlockData thindata;
@@ -9,6 +9,10 @@
 #include "hashwrapper.h"
 #include "pubkey.h"
 
+namespace siphash_avx2
+{
+void SipHashUint256_4way(uint64_t k0, uint64_t k1, const unsigned char *in, uint64_t *out);
+}
 
 inline uint32_t ROTL32(uint32_t x, int8_t r) { return (x << r) | (x >> (32 - r)); }
 unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char> &vDataToHash)
@@ -267,3 +271,80 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256 &val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+namespace
+{
+typedef void (*SipHashUint256_4wayType)(uint64_t k0, uint64_t k1, const unsigned char *in, uint64_t *out);
+SipHashUint256_4wayType SipHashUint256_4way = nullptr;
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#define USE_SIPHASH_AVX2
+void inline cpuid(uint32_t leaf, uint32_t subleaf, uint32_t &a, uint32_t &b, uint32_t &c, uint32_t &d)
+{
+    __asm__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(leaf), "2"(subleaf));
+}
+
+/** Whether the CPU has AVX2 and the OS saves the AVX registers */
+bool HaveAVX2()
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0, 0, eax, ebx, ecx, edx);
+    if (eax < 7)
+        return false;
+    cpuid(1, 0, eax, ebx, ecx, edx);
+    if (!((ecx >> 27) & 1)) // OSXSAVE
+        return false;
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6) // XMM and YMM state
+        return false;
+    cpuid(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+
+bool SelfTest4way(SipHashUint256_4wayType fn)
+{
+    uint256 vals[4];
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 32; j++)
+            *(vals[i].begin() + j) = (unsigned char)(i * 32 + j);
+    }
+    uint64_t out[4];
+    fn(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, vals[0].begin(), out);
+    for (int i = 0; i < 4; i++)
+    {
+        if (out[i] != SipHashUint256(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, vals[i]))
+            return false;
+    }
+    return true;
+}
+#endif
+} // namespace
+
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256 *vals, uint64_t *out, size_t n)
+{
+    static_assert(sizeof(uint256) == 32, "the 4-way implementation assumes that an array of uint256 is contiguous");
+    size_t i = 0;
+    if (SipHashUint256_4way)
+    {
+        for (; i + 4 <= n; i += 4)
+            SipHashUint256_4way(k0, k1, vals[i].begin(), out + i);
+    }
+    for (; i < n; i++)
+        out[i] = SipHashUint256(k0, k1, vals[i]);
+}
+
+std::string SipHashAutoDetect()
+{
+    std::string ret = "standard";
+#ifdef USE_SIPHASH_AVX2
+    if (HaveAVX2() && SelfTest4way(siphash_avx2::SipHashUint256_4way))
+    {
+        SipHashUint256_4way = siphash_avx2::SipHashUint256_4way;
+        ret = "avx2(4way)";
+    }
+#endif
+    return ret;
+}
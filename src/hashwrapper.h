@@ -14,6 +14,7 @@
 #include "uint256.h"
 #include "version.h"
 
+#include <string>
 #include <vector>
 
 typedef uint256 ChainCode;
@@ -264,4 +265,15 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256 &val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256 &val, uint32_t extra);
 
+/** SipHashUint256 of each of the n values in vals, written to out.
+ *
+ *  Hashes four values at a time with AVX2 if SipHashAutoDetect found it.
+ */
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256 *vals, uint64_t *out, size_t n);
+
+/** Autodetect the best available SipHashUint256Batch implementation.
+ *  Returns the name of the implementation.
+ */
+std::string SipHashAutoDetect();
+
 #endif // BITCOIN_HASH_H
@@ -26,6 +26,7 @@ SOFTWARE.
 #include <iostream>
 #include <list>
 #include <sstream>
+#include <stdexcept>
 #include <utility>
 
 static const size_t N_HASHCHECK = 11;
@@ -34,24 +35,39 @@ static const size_t N_HASHCHECK = 11;
 static const float MIN_OVERHEAD = 0.1;
 
 
-static inline uint32_t keyChecksumCalc(const std::vector<uint8_t> &kvec) { return MurmurHash3(N_HASHCHECK, kvec); }
-template <typename T>
-std::vector<uint8_t> ToVec(T number)
+// MurmurHash3 of the 8 little endian bytes of k, without putting them in a vector first
+static inline uint32_t MurmurHash3Uint64(uint32_t nHashSeed, uint64_t k)
 {
-    std::vector<uint8_t> v(sizeof(T));
-    for (size_t i = 0; i < sizeof(T); i++)
+    const uint32_t c1 = 0xcc9e2d51;
+    const uint32_t c2 = 0x1b873593;
+
+    uint32_t h1 = nHashSeed;
+    for (uint32_t k1 : {(uint32_t)k, (uint32_t)(k >> 32)})
     {
-        v.at(i) = (number >> i * 8) & 0xff;
+        k1 *= c1;
+        k1 = (k1 << 15) | (k1 >> 17);
+        k1 *= c2;
+
+        h1 ^= k1;
+        h1 = (h1 << 13) | (h1 >> 19);
+        h1 = h1 * 5 + 0xe6546b64;
     }
-    return v;
-}
 
+    h1 ^= sizeof(k);
+    h1 ^= h1 >> 16;
+    h1 *= 0x85ebca6b;
+    h1 ^= h1 >> 13;
+    h1 *= 0xc2b2ae35;
+    h1 ^= h1 >> 16;
+    return h1;
+}
 
+static inline uint32_t keyChecksumCalc(uint64_t k) { return MurmurHash3Uint64(N_HASHCHECK, k); }
 bool BaseHashTableEntry::isPure(uint32_t keycheckMask) const
 {
     if (count == 1 || count == -1)
     {
-        uint32_t check = (keyChecksumCalc(ToVec(keySum)) & keycheckMask);
+        uint32_t check = (keyChecksumCalc(keySum) & keycheckMask);
         return (keyCheck == check);
     }
     return false;
@@ -74,7 +90,7 @@ void BaseHashTableEntry::addValue(const std::vector<uint8_t> &v)
     }
 }
 
-CIblt::CIblt()
+CIblt::CIblt() : valueWidth(0)
 {
     salt = 0;
     n_hash = 1;
@@ -83,7 +99,7 @@ CIblt::CIblt()
     keycheckMask = MAX_CHECKSUM_MASK;
 }
 
-CIblt::CIblt(uint64_t _version)
+CIblt::CIblt(uint64_t _version) : valueWidth(0)
 {
     salt = 0;
     n_hash = 1;
@@ -94,14 +110,14 @@ CIblt::CIblt(uint64_t _version)
 }
 
 CIblt::CIblt(size_t _expectedNumEntries, uint64_t _version)
-    : salt(0), n_hash(0), is_modified(false), keycheckMask(MAX_CHECKSUM_MASK)
+    : salt(0), n_hash(0), is_modified(false), keycheckMask(MAX_CHECKSUM_MASK), valueWidth(0)
 {
     CIblt::version = _version;
     CIblt::resize(_expectedNumEntries);
 }
 
 CIblt::CIblt(size_t _expectedNumEntries, uint32_t _salt, uint64_t _version)
-    : n_hash(0), is_modified(false), keycheckMask(MAX_CHECKSUM_MASK)
+    : n_hash(0), is_modified(false), keycheckMask(MAX_CHECKSUM_MASK), valueWidth(0)
 {
     CIblt::version = _version;
     CIblt::salt = _salt;
@@ -109,7 +125,7 @@ CIblt::CIblt(size_t _expectedNumEntries, uint32_t _salt, uint64_t _version)
 }
 
 CIblt::CIblt(size_t _expectedNumEntries, uint32_t _salt, uint64_t _version, uint32_t _keycheckMask)
-    : n_hash(0), is_modified(false)
+    : n_hash(0), is_modified(false), valueWidth(0)
 {
     CIblt::version = _version;
     CIblt::salt = _salt;
@@ -123,20 +139,33 @@ CIblt::CIblt(const CIblt &other) : n_hash(0), is_modified(false)
     version = other.version;
     n_hash = other.n_hash;
     keycheckMask = other.keycheckMask;
-    hashTable = other.hashTable;
+    vCount = other.vCount;
+    vKeySum = other.vKeySum;
+    vKeyCheck = other.vKeyCheck;
+    vValueLen = other.vValueLen;
+    vValueSum = other.vValueSum;
+    valueWidth = other.valueWidth;
     mapHashIdxSeeds = other.mapHashIdxSeeds;
 }
 
 CIblt::~CIblt() {}
 void CIblt::reset()
 {
-    size_t size = this->size();
-    hashTable.clear();
-    hashTable.resize(size);
+    clearCells(size(), 0);
     is_modified = false;
 }
 
-uint64_t CIblt::size() { return hashTable.size(); }
+uint64_t CIblt::size() { return vCount.size(); }
+void CIblt::clearCells(size_t nCells, size_t nWidth)
+{
+    vCount.assign(nCells, 0);
+    vKeySum.assign(nCells, 0);
+    vKeyCheck.assign(nCells, 0);
+    vValueLen.assign(nCells, 0);
+    vValueSum.assign(nCells * nWidth, 0);
+    valueWidth = nWidth;
+}
+
 void CIblt::resize(size_t _expectedNumEntries)
 {
     assert(is_modified == false);
@@ -152,7 +181,19 @@ void CIblt::resize(size_t _expectedNumEntries)
     // ... make nEntries exactly divisible by n_hash
     while (n_hash * (nEntries / n_hash) != nEntries)
         ++nEntries;
-    hashTable.resize(nEntries);
+    clearCells(nEntries, valueWidth);
+}
+
+void CIblt::widenValues(size_t nWidth)
+{
+    std::vector<uint8_t> vWider(vCount.size() * nWidth, 0);
+    for (size_t i = 0; i < vCount.size(); i++)
+    {
+        auto itValue = vValueSum.begin() + i * valueWidth;
+        std::copy(itValue, itValue + valueWidth, vWider.begin() + i * nWidth);
+    }
+    vValueSum.swap(vWider);
+    valueWidth = nWidth;
 }
 
 uint32_t CIblt::saltedHashValue(size_t hashFuncIdx, const std::vector<uint8_t> &kvec) const
@@ -166,147 +207,179 @@ uint32_t CIblt::saltedHashValue(size_t hashFuncIdx, const std::vector<uint8_t> &
         return MurmurHash3(hashFuncIdx, kvec);
 }
 
+size_t CIblt::cellIndex(size_t hashFuncIdx, uint64_t k, size_t bucketsPerHash) const
+{
+    uint32_t seed = version > 0 ? mapHashIdxSeeds.at(hashFuncIdx) : hashFuncIdx;
+    return hashFuncIdx * bucketsPerHash + (MurmurHash3Uint64(seed, k) % bucketsPerHash);
+}
+
+bool CIblt::isPure(size_t idx) const
+{
+    if (vCount[idx] == 1 || vCount[idx] == -1)
+        return vKeyCheck[idx] == (keyChecksumCalc(vKeySum[idx]) & keycheckMask);
+    return false;
+}
+
+std::vector<uint8_t> CIblt::getValue(size_t idx) const
+{
+    auto itValue = vValueSum.begin() + idx * valueWidth;
+    return std::vector<uint8_t>(itValue, itValue + vValueLen[idx]);
+}
+
+void CIblt::updateCell(size_t idx, int32_t count, uint64_t k, uint32_t kchk, const uint8_t *pValue, size_t nValueLen)
+{
+    vCount[idx] += count;
+    vKeySum[idx] ^= k;
+    vKeyCheck[idx] = (vKeyCheck[idx] ^ kchk) & keycheckMask;
+
+    uint8_t *pCellValue = vValueSum.data() + idx * valueWidth;
+    if (isEmpty(idx))
+    {
+        std::fill(pCellValue, pCellValue + valueWidth, 0);
+        vValueLen[idx] = 0;
+    }
+    else if (nValueLen > 0)
+    {
+        for (size_t i = 0; i < nValueLen; i++)
+            pCellValue[i] ^= pValue[i];
+        vValueLen[idx] = std::max<size_t>(vValueLen[idx], nValueLen);
+    }
+}
+
 void CIblt::_insert(int plusOrMinus, uint64_t k, const std::vector<uint8_t> &v)
 {
     if (!n_hash)
         return;
-    size_t bucketsPerHash = hashTable.size() / n_hash;
+    size_t bucketsPerHash = vCount.size() / n_hash;
     if (!bucketsPerHash)
         return;
 
-    std::vector<uint8_t> kvec = ToVec(k);
-    const uint32_t kchk = keyChecksumCalc(kvec);
+    if (v.size() > IBLT_MAX_VALUE_SIZE)
+        throw std::invalid_argument("IBLT value exceeds the maximum size");
+    if (v.size() > valueWidth)
+        widenValues(v.size());
 
+    const uint32_t kchk = keyChecksumCalc(k);
     for (size_t i = 0; i < n_hash; i++)
-    {
-        size_t startEntry = i * bucketsPerHash;
-
-        uint32_t h = saltedHashValue(i, kvec);
-        HashTableEntry &entry = hashTable.at(startEntry + (h % bucketsPerHash));
-        entry.count += plusOrMinus;
-        entry.keySum ^= k;
-        entry.keyCheck = (entry.keyCheck ^ kchk) & keycheckMask;
-        if (entry.empty())
-        {
-            entry.valueSum.clear();
-        }
-        else
-        {
-            entry.addValue(v);
-        }
-    }
+        updateCell(cellIndex(i, k, bucketsPerHash), plusOrMinus, k, kchk, v.data(), v.size());
 
     is_modified = true;
 }
 
 void CIblt::insert(uint64_t k, const std::vector<uint8_t> &v) { _insert(1, k, v); }
 void CIblt::erase(uint64_t k, const std::vector<uint8_t> &v) { _insert(-1, k, v); }
-bool CIblt::get(uint64_t k, std::vector<uint8_t> &result) const
+bool CIblt::lookup(uint64_t k, std::vector<uint8_t> &result) const
 {
-    result.clear();
-
-
-    if (!n_hash)
-        return false;
-    size_t bucketsPerHash = hashTable.size() / n_hash;
-    if (!bucketsPerHash)
-        return false;
-
-    std::vector<uint8_t> kvec = ToVec(k);
-
+    size_t bucketsPerHash = vCount.size() / n_hash;
     for (size_t i = 0; i < n_hash; i++)
     {
-        size_t startEntry = i * bucketsPerHash;
-
-        uint32_t h = saltedHashValue(i, kvec);
-        const HashTableEntry &entry = hashTable.at(startEntry + (h % bucketsPerHash));
-
-        if (entry.empty())
+        size_t idx = cellIndex(i, k, bucketsPerHash);
+        if (isEmpty(idx))
         {
             // Definitely not in table. Leave
             // result empty, return true.
             return true;
         }
-        else if (entry.isPure(keycheckMask))
+        else if (isPure(idx))
         {
-            if (entry.keySum == k)
+            if (vKeySum[idx] == k)
             {
                 // Found!
-                result.assign(entry.valueSum.begin(), entry.valueSum.end());
-                return true;
-            }
-            else
-            {
-                // Definitely not in table.
-                return true;
+                result = getValue(idx);
             }
+            // Otherwise definitely not in table.
+            return true;
         }
     }
+    return false;
+}
+
+bool CIblt::get(uint64_t k, std::vector<uint8_t> &result) const
+{
+    result.clear();
+
+
+    if (!n_hash)
+        return false;
+    size_t bucketsPerHash = vCount.size() / n_hash;
+    if (!bucketsPerHash)
+        return false;
+
+    if (lookup(k, result))
+        return true;
 
     // Don't know if k is in table or not; "peel" the IBLT to try to find
     // it:
     CIblt peeled = *this;
+    bool fFound = false;
+    peeled.peel([k, &result, &fFound](uint64_t key, int32_t count, const std::vector<uint8_t> &v) {
+        if (key != k)
+            return true;
+        result = v;
+        fFound = true;
+        return false;
+    });
+    return fFound || peeled.lookup(k, result);
+}
+
+void CIblt::peel(const std::function<bool(uint64_t k, int32_t count, const std::vector<uint8_t> &v)> &fnPeeled)
+{
+    if (!n_hash)
+        return;
+    size_t bucketsPerHash = vCount.size() / n_hash;
+    if (!bucketsPerHash)
+        return;
+
+    std::vector<size_t> vPure;
+    for (size_t i = 0; i < vCount.size(); i++)
+    {
+        if (isPure(i))
+            vPure.push_back(i);
+    }
+
+    // A cell can look pure when it is not, so the number of keys peeled off is limited in case they never run out
     size_t nErased = 0;
-    for (size_t i = 0; i < peeled.hashTable.size(); i++)
+    while (!vPure.empty() && nErased < vCount.size() / MIN_OVERHEAD)
     {
-        HashTableEntry &entry = peeled.hashTable.at(i);
-        if (entry.isPure(keycheckMask))
+        size_t idx = vPure.back();
+        vPure.pop_back();
+        // The cell may have changed since it was found to be pure
+        if (!isPure(idx))
+            continue;
+
+        const uint64_t k = vKeySum[idx];
+        const int32_t count = vCount[idx];
+        const std::vector<uint8_t> v = getValue(idx);
+        if (!fnPeeled(k, count, v))
+            return;
+
+        const uint32_t kchk = keyChecksumCalc(k);
+        for (size_t i = 0; i < n_hash; i++)
         {
-            if (entry.keySum == k)
-            {
-                // Found!
-                result.assign(entry.valueSum.begin(), entry.valueSum.end());
-                return true;
-            }
-            ++nErased;
-            // NOTE: Need to create a copy of valueSum here as entry is just a reference!
-            std::vector<uint8_t> vec = entry.valueSum;
-            peeled._insert(-entry.count, entry.keySum, vec);
+            size_t cell = cellIndex(i, k, bucketsPerHash);
+            updateCell(cell, -count, k, kchk, v.data(), v.size());
+            if (isPure(cell))
+                vPure.push_back(cell);
         }
+        ++nErased;
     }
-    if (nErased > 0)
-    {
-        // Recurse with smaller IBLT
-        return peeled.get(k, result);
-    }
-    return false;
 }
 
 bool CIblt::listEntries(std::set<std::pair<uint64_t, std::vector<uint8_t> > > &positive,
     std::set<std::pair<uint64_t, std::vector<uint8_t> > > &negative) const
 {
     CIblt peeled = *this;
-
-    size_t nErased = 0;
-    size_t nTotalErased = 0;
-    do
-    {
-        nErased = 0;
-        for (size_t i = 0; i < peeled.hashTable.size(); i++)
-        {
-            HashTableEntry &entry = peeled.hashTable.at(i);
-            if (entry.isPure(keycheckMask))
-            {
-                if (entry.count == 1)
-                {
-                    positive.insert(std::make_pair(entry.keySum, entry.valueSum));
-                }
-                else
-                {
-                    negative.insert(std::make_pair(entry.keySum, entry.valueSum));
-                }
-                // NOTE: Need to create a copy of valueSum here as entry is just a reference!
-                std::vector<uint8_t> vec = entry.valueSum;
-                peeled._insert(-entry.count, entry.keySum, vec);
-                ++nErased;
-            }
-        }
-        nTotalErased += nErased;
-    } while (nErased > 0 && nTotalErased < peeled.hashTable.size() / MIN_OVERHEAD);
+    peeled.peel([&positive, &negative](uint64_t k, int32_t count, const std::vector<uint8_t> &v) {
+        if (count == 1)
+            positive.insert(std::make_pair(k, v));
+        else
+            negative.insert(std::make_pair(k, v));
+        return true;
+    });
 
     if (!n_hash)
         return false;
-    size_t peeled_bucketsPerHash = peeled.hashTable.size() / n_hash;
+    size_t peeled_bucketsPerHash = peeled.vCount.size() / n_hash;
     if (!peeled_bucketsPerHash)
         return false;
 
@@ -314,7 +387,7 @@ bool CIblt::listEntries(std::set<std::pair<uint64_t, std::vector<uint8_t> > > &p
     // then we didn't peel them all:
     for (size_t i = 0; i < peeled_bucketsPerHash; i++)
     {
-        if (peeled.hashTable.at(i).empty() != true)
+        if (!peeled.isEmpty(i))
             return false;
     }
     return true;
@@ -323,24 +396,55 @@ bool CIblt::listEntries(std::set<std::pair<uint64_t, std::vector<uint8_t> > > &p
 CIblt CIblt::operator-(const CIblt &other) const
 {
     // IBLT's must be same params/size:
-    assert(hashTable.size() == other.hashTable.size());
+    assert(vCount.size() == other.vCount.size());
 
     CIblt result(*this);
-    for (size_t i = 0; i < hashTable.size(); i++)
+    if (other.valueWidth > result.valueWidth)
+        result.widenValues(other.valueWidth);
+
+    // Each field is combined in a loop of its own, which the compiler turns into vector instructions
+    const size_t nCells = vCount.size();
+    int32_t *pCount = result.vCount.data();
+    uint64_t *pKeySum = result.vKeySum.data();
+    uint32_t *pKeyCheck = result.vKeyCheck.data();
+    const int32_t *pOtherCount = other.vCount.data();
+    const uint64_t *pOtherKeySum = other.vKeySum.data();
+    const uint32_t *pOtherKeyCheck = other.vKeyCheck.data();
+    for (size_t i = 0; i < nCells; i++)
+        pCount[i] -= pOtherCount[i];
+    for (size_t i = 0; i < nCells; i++)
+        pKeySum[i] ^= pOtherKeySum[i];
+    for (size_t i = 0; i < nCells; i++)
+        pKeyCheck[i] = (pKeyCheck[i] ^ pOtherKeyCheck[i]) & keycheckMask;
+
+    if (result.valueWidth == 0)
+        return result;
+
+    if (other.valueWidth == result.valueWidth)
+    {
+        uint8_t *pValueSum = result.vValueSum.data();
+        const uint8_t *pOtherValueSum = other.vValueSum.data();
+        for (size_t i = 0; i < result.vValueSum.size(); i++)
+            pValueSum[i] ^= pOtherValueSum[i];
+    }
+    else
     {
-        HashTableEntry &e1 = result.hashTable.at(i);
-        const HashTableEntry &e2 = other.hashTable.at(i);
-        e1.count -= e2.count;
-        e1.keySum ^= e2.keySum;
-        e1.keyCheck = (e1.keyCheck ^ e2.keyCheck) & keycheckMask;
-        if (e1.empty())
+        for (size_t i = 0; i < nCells; i++)
         {
-            e1.valueSum.clear();
+            for (size_t j = 0; j < other.vValueLen[i]; j++)
+                result.vValueSum[i * result.valueWidth + j] ^= other.vValueSum[i * other.valueWidth + j];
         }
-        else
+    }
+    for (size_t i = 0; i < nCells; i++)
+    {
+        if (result.isEmpty(i))
         {
-            e1.addValue(e2.valueSum);
+            std::fill(result.vValueSum.begin() + i * result.valueWidth,
+                result.vValueSum.begin() + (i + 1) * result.valueWidth, 0);
+            result.vValueLen[i] = 0;
         }
+        else
+            result.vValueLen[i] = std::max(result.vValueLen[i], other.vValueLen[i]);
     }
 
     return result;
@@ -352,11 +456,10 @@ std::string CIblt::DumpTable() const
     std::ostringstream result;
 
     result << "count keySum keyCheckMatch\n";
-    for (size_t i = 0; i < hashTable.size(); i++)
+    for (size_t i = 0; i < vCount.size(); i++)
     {
-        const HashTableEntry &entry = hashTable.at(i);
-        result << entry.count << " " << entry.keySum << " ";
-        result << ((keyChecksumCalc(ToVec(entry.keySum)) & keycheckMask) == entry.keyCheck ? "true" : "false");
+        result << vCount[i] << " " << vKeySum[i] << " ";
+        result << ((keyChecksumCalc(vKeySum[i]) & keycheckMask) == vKeyCheck[i] ? "true" : "false");
         result << "\n";
     }
 
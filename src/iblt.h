@@ -24,7 +24,10 @@ SOFTWARE.
 
 #include "serialize.h"
 
+#include <algorithm>
+#include <functional>
 #include <inttypes.h>
+#include <map>
 #include <set>
 #include <vector>
 
@@ -42,6 +45,13 @@ SOFTWARE.
 
 const uint64_t IBLT_MAX_VERSION_SUPPORTED = 2;
 const uint32_t MAX_CHECKSUM_MASK = 0xffffffff;
+// The longest value that can be stored with a key
+const size_t IBLT_MAX_VALUE_SIZE = 255;
+// Every cell of a table has room for its longest value, so one long value in a received table would make every cell
+// that long.  A received table may take at most this many times the value bytes it was sent with, or
+// IBLT_MAX_WIDENED_VALUE_BYTES if that is more, for its values.
+const size_t IBLT_MAX_VALUE_WIDENING = 4;
+const size_t IBLT_MAX_WIDENED_VALUE_BYTES = 64 * 1024;
 
 class BaseHashTableEntry
 {
@@ -182,13 +192,12 @@ public:
         if (version >= 2)
         {
             READWRITE(keycheckMask);
+            std::vector<HashTableEntry> hashTable;
+            if (!ser_action.ForRead())
+                getEntries(hashTable);
             READWRITE(hashTable);
-            // Ensure that keyChecks do not exceed keycheckMask
             if (ser_action.ForRead())
-            {
-                for (auto entry : hashTable)
-                    entry.keyCheck = entry.keyCheck & keycheckMask;
-            }
+                setEntries(hashTable);
         }
         else
         {
@@ -197,27 +206,11 @@ public:
             {
                 keycheckMask = MAX_CHECKSUM_MASK;
                 READWRITE(hashTableChk);
-                for (auto entryChk : hashTableChk)
-                {
-                    HashTableEntry entry;
-                    entry.count = entryChk.count;
-                    entry.keySum = entryChk.keySum;
-                    entry.keyCheck = entryChk.keyCheck;
-                    entry.valueSum = entryChk.valueSum;
-                    hashTable.push_back(entry);
-                }
+                setEntries(hashTableChk);
             }
             else
             {
-                for (auto entry : hashTable)
-                {
-                    HashTableEntryStaticChk entryChk;
-                    entryChk.count = entry.count;
-                    entryChk.keySum = entry.keySum;
-                    entryChk.keyCheck = entry.keyCheck;
-                    entryChk.valueSum = entry.valueSum;
-                    hashTableChk.push_back(entryChk);
-                }
+                getEntries(hashTableChk);
                 READWRITE(hashTableChk);
             }
         }
@@ -228,6 +221,62 @@ public:
 protected:
     void _insert(int plusOrMinus, uint64_t k, const std::vector<uint8_t> &v);
 
+    // Combine a key and value into the cell at idx, as the insert or erase of a key does for each of its cells
+    void updateCell(size_t idx, int32_t count, uint64_t k, uint32_t kchk, const uint8_t *pValue, size_t nValueLen);
+    // The cell of k for hash function hashFuncIdx
+    size_t cellIndex(size_t hashFuncIdx, uint64_t k, size_t bucketsPerHash) const;
+    bool isPure(size_t idx) const;
+    bool isEmpty(size_t idx) const { return vCount[idx] == 0 && vKeySum[idx] == 0 && vKeyCheck[idx] == 0; }
+    std::vector<uint8_t> getValue(size_t idx) const;
+    // Make room for values of nWidth bytes in every cell
+    void widenValues(size_t nWidth);
+    // Whether the cells of k tell for certain if k is in the table, and if so its value
+    bool lookup(uint64_t k, std::vector<uint8_t> &result) const;
+    // Take the keys of pure cells out of the table one at a time, until there are none or fnPeeled returns false.
+    // Only the cells that a peeled key was taken out of can become pure, so those are the only ones checked again.
+    void peel(const std::function<bool(uint64_t k, int32_t count, const std::vector<uint8_t> &v)> &fnPeeled);
+
+    // Convert between the cells and the entries they are serialized as
+    template <typename Entry>
+    void getEntries(std::vector<Entry> &entries) const
+    {
+        entries.resize(vCount.size());
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            entries[i].count = vCount[i];
+            entries[i].keySum = vKeySum[i];
+            entries[i].keyCheck = vKeyCheck[i];
+            entries[i].valueSum = getValue(i);
+        }
+    }
+    template <typename Entry>
+    void setEntries(const std::vector<Entry> &entries)
+    {
+        size_t nWidth = 0;
+        size_t nValueBytes = 0;
+        for (const Entry &entry : entries)
+        {
+            nWidth = std::max(nWidth, entry.valueSum.size());
+            nValueBytes += entry.valueSum.size();
+        }
+        if (nWidth > IBLT_MAX_VALUE_SIZE)
+            throw std::ios_base::failure("IBLT value exceeds the maximum size");
+        if (entries.size() * nWidth > std::max(nValueBytes * IBLT_MAX_VALUE_WIDENING, IBLT_MAX_WIDENED_VALUE_BYTES))
+            throw std::ios_base::failure("IBLT values are too sparse for the width of the longest one");
+
+        clearCells(entries.size(), nWidth);
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            vCount[i] = entries[i].count;
+            vKeySum[i] = entries[i].keySum;
+            // Ensure that keyChecks do not exceed keycheckMask
+            vKeyCheck[i] = entries[i].keyCheck & keycheckMask;
+            vValueLen[i] = entries[i].valueSum.size();
+            std::copy(entries[i].valueSum.begin(), entries[i].valueSum.end(), vValueSum.begin() + i * valueWidth);
+        }
+    }
+    void clearCells(size_t nCells, size_t nWidth);
+
     // This salt is used to seed the IBLT hash functions. When its value (passed in via constructor)
     // is derived from a pseudo-random value, the IBLT hash functions themselves become randomized.
     uint32_t salt;
@@ -236,7 +285,16 @@ protected:
     bool is_modified;
     uint32_t keycheckMask;
 
-    std::vector<HashTableEntry> hashTable;
+    // The cells of the table, with one array for each of their fields, so that whole tables are combined with
+    // simple loops that the compiler vectorizes.  Every cell has room for a value of valueWidth bytes, which is the
+    // longest value ever added to the table, and vValueLen holds the length the value of each cell is serialized with.
+    std::vector<int32_t> vCount;
+    std::vector<uint64_t> vKeySum;
+    std::vector<uint32_t> vKeyCheck;
+    std::vector<uint8_t> vValueLen;
+    std::vector<uint8_t> vValueSum;
+    size_t valueWidth;
+
     std::map<uint8_t, uint32_t> mapHashIdxSeeds;
 };
 
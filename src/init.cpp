@@ -25,6 +25,7 @@
 #include "electrum/electrumserver.h"
 #include "forks_csv.h"
 #include "fs.h"
+#include "hashwrapper.h"
 #include "httprpc.h"
 #include "httpserver.h"
 #include "httpserver.h"
@@ -54,6 +55,7 @@
 #include "util.h"
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
+#include "utxosnapshot.h"
 #include "validation/validation.h"
 #include "validation/verifydb.h"
 #include "validationinterface.h"
@@ -149,6 +151,18 @@ void StartShutdown() { fRequestShutdown = true; }
 bool ShutdownRequested() { return fRequestShutdown; }
 class CCoinsViewErrorCatcher : public CCoinsViewBacked
 {
+    [[noreturn]] static void ReadError(const std::runtime_error &e)
+    {
+        uiInterface.ThreadSafeMessageBox(
+            _("Error reading from database, shutting down."), "", CClientUIInterface::MSG_ERROR);
+        LOGA("Error reading from database: %s\n", e.what());
+        // Starting the shutdown sequence and returning false to the caller would be
+        // interpreted as 'entry not found' (as opposed to unable to read data), and
+        // could lead to invalid interpretation. Just exit immediately, as we can't
+        // continue anyway, and all writes should be atomic.
+        abort();
+    }
+
 public:
     CCoinsViewErrorCatcher(CCoinsView *view) : CCoinsViewBacked(view) {}
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override
@@ -159,14 +173,18 @@ public:
         }
         catch (const std::runtime_error &e)
         {
-            uiInterface.ThreadSafeMessageBox(
-                _("Error reading from database, shutting down."), "", CClientUIInterface::MSG_ERROR);
-            LOGA("Error reading from database: %s\n", e.what());
-            // Starting the shutdown sequence and returning false to the caller would be
-            // interpreted as 'entry not found' (as opposed to unable to read data), and
-            // could lead to invalid interpretation. Just exit immediately, as we can't
-            // continue anyway, and all writes should be atomic.
-            abort();
+            ReadError(e);
+        }
+    }
+    size_t GetCoins(const std::vector<COutPoint> &outpoints, std::vector<Coin> &coins) const override
+    {
+        try
+        {
+            return base->GetCoins(outpoints, coins);
+        }
+        catch (const std::runtime_error &e)
+        {
+            ReadError(e);
         }
     }
     // Writes do not need similar protection, as failure to write is handled by the caller.
@@ -595,11 +613,8 @@ void ThreadImport(std::vector<fs::path> vImportFiles, uint64_t nTxIndexCache)
         int nIterations = 0;
         while (1)
         {
-            {
-                LOCK(csTxInQ);
-                nInQ = txInQ.size();
-                nDeferQ = txDeferQ.size();
-            }
+            nInQ = txInQ.size();
+            nDeferQ = txDeferQ.size();
             {
                 boost::unique_lock<boost::mutex> lock(csCommitQ);
                 nCommitQ = txCommitQ->size();
@@ -613,13 +628,8 @@ void ThreadImport(std::vector<fs::path> vImportFiles, uint64_t nTxIndexCache)
             {
                 LOGA("Clearing Queues because they are not empty: txInq %d, txDeferQ %d, txCommitQ %d\n", nInQ, nDeferQ,
                     nCommitQ);
-                {
-                    LOCK(csTxInQ);
-                    while (!txInQ.empty())
-                        txInQ.pop();
-                    while (!txDeferQ.empty())
-                        txDeferQ.pop();
-                }
+                txInQ.clear();
+                txDeferQ.clear();
                 {
                     boost::unique_lock<boost::mutex> lock(csCommitQ);
                     txCommitQ->clear();
@@ -1116,8 +1126,10 @@ bool AppInit2(Config &config)
 
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
+    std::string siphash_algo = SipHashAutoDetect();
     RandomInit();
     LOGA("Using the '%s' SHA256 implementation\n", sha256_algo);
+    LOGA("Using the '%s' SipHash implementation\n", siphash_algo);
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
 
@@ -1356,6 +1368,7 @@ bool AppInit2(Config &config)
                 COverrideOptions overridecache;
                 overridecache.block_size = 4096;
                 pcoinsdbview = new CCoinsViewDB(cacheConfig.nCoinDBCache, false, fReindex, true, &overridecache);
+                pcoinsdbview->EnableWriteBehind(GetBoolArg("-dbwritebehind", DEFAULT_DB_WRITE_BEHIND));
 
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 uiInterface.InitMessage(_("Opening Coins Cache database..."));
@@ -1378,6 +1391,18 @@ bool AppInit2(Config &config)
                         break;
                     }
                 }
+                if (!pcoinsdbview->LoadUtxoCommitment())
+                {
+                    strLoadError = _("Error computing the UTXO set commitment");
+                    break;
+                }
+                const bool fCoinsIncomplete = pcoinsdbview->IsIncomplete();
+                if (fCoinsIncomplete && !mapArgs.count("-loadutxoset"))
+                {
+                    strLoadError = _("The chainstate database is incomplete because loading a UTXO snapshot was "
+                                     "interrupted");
+                    break;
+                }
 
                 uiInterface.InitMessage(_("Loading block index..."));
                 if (!LoadBlockIndex())
@@ -1428,7 +1453,9 @@ bool AppInit2(Config &config)
                                      "and time are correct");
                     break;
                 }
-                if (!CVerifyDB().VerifyDB(chainparams, pcoinsdbview, GetArg("-checklevel", DEFAULT_CHECKLEVEL),
+                // The coins of an incomplete database are about to be replaced, so there is nothing to verify
+                if (!fCoinsIncomplete &&
+                    !CVerifyDB().VerifyDB(chainparams, pcoinsdbview, GetArg("-checklevel", DEFAULT_CHECKLEVEL),
                         GetArg("-checkblocks", DEFAULT_CHECKBLOCKS)))
                 {
                     strLoadError = _("Corrupted block database detected");
@@ -1484,6 +1511,18 @@ bool AppInit2(Config &config)
     }
     LOGA(" block index %15dms\n", GetTimeMillis() - nStart);
 
+    if (mapArgs.count("-loadutxoset"))
+    {
+        uiInterface.InitMessage(_("Loading UTXO snapshot..."));
+        const std::string strCommitment = GetArg("-loadutxosetcommitment", "");
+        if (strCommitment.size() != 64 || !IsHex(strCommitment))
+            return InitError(_("-loadutxoset requires the expected UTXO set commitment in -loadutxosetcommitment"));
+        CUtxoSnapshotHeader header;
+        std::string strError;
+        if (!LoadUtxoSnapshot(GetArg("-loadutxoset", ""), uint256S(strCommitment), header, strError))
+            return InitError(strprintf(_("Unable to load the UTXO snapshot: %s"), strError));
+    }
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -0,0 +1,177 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_LOCKFREEQUEUE_H
+#define BITCOIN_LOCKFREEQUEUE_H
+
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+/**
+ * A bounded multi-producer, multi-consumer FIFO queue.
+ *
+ * Push and pop never take a lock.  Each cell carries a sequence number that tells producers and consumers
+ * whether the cell is free to be written or ready to be read, so contention is limited to a single
+ * compare-and-swap on the head or tail position (see D. Vyukov's bounded MPMC queue).
+ *
+ * Since the queue is bounded, push() fails rather than blocks when the queue is full.  The caller decides
+ * what to do with the element.
+ *
+ * Idle consumers do not need to spin: wait() blocks on a condition variable until an element is available
+ * (or a timeout expires).  Producers only touch the condition variable's mutex if a consumer is actually
+ * waiting, so the fast path stays lock free.
+ *
+ * The capacity must be a power of 2.
+ */
+template <typename T>
+class CLockFreeQueue
+{
+protected:
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    // Avoid false sharing between the producer and consumer positions
+    static const size_t CACHE_LINE = 64;
+
+    std::unique_ptr<Cell[]> cells;
+    const size_t mask;
+    alignas(CACHE_LINE) std::atomic<size_t> enqueuePos;
+    alignas(CACHE_LINE) std::atomic<size_t> dequeuePos;
+
+    // Blocking fallback for idle consumers
+    alignas(CACHE_LINE) std::atomic<unsigned int> nWaiters;
+    std::mutex cs_wait;
+    std::condition_variable cv_wait;
+
+    template <typename U>
+    bool _push(U &&elem)
+    {
+        Cell *cell;
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &cells[pos & mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false; // full
+            else
+                pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+        cell->data = std::forward<U>(elem);
+        cell->seq.store(pos + 1, std::memory_order_release);
+
+        // Pairs with the fence in wait(): either the waiter sees this element, or we see the waiter.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (nWaiters.load(std::memory_order_relaxed) != 0)
+        {
+            std::lock_guard<std::mutex> lock(cs_wait);
+            cv_wait.notify_one();
+        }
+        return true;
+    }
+
+public:
+    CLockFreeQueue(size_t capacity) : cells(new Cell[capacity]), mask(capacity - 1)
+    {
+        assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+        for (size_t i = 0; i < capacity; i++)
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        enqueuePos.store(0, std::memory_order_relaxed);
+        dequeuePos.store(0, std::memory_order_relaxed);
+        nWaiters.store(0, std::memory_order_relaxed);
+    }
+
+    CLockFreeQueue(const CLockFreeQueue &) = delete;
+    CLockFreeQueue &operator=(const CLockFreeQueue &) = delete;
+
+    /** Add an element to the back of the queue.  Returns false (and leaves elem untouched) if the queue is full */
+    bool push(const T &elem) { return _push(elem); }
+    bool push(T &&elem) { return _push(std::move(elem)); }
+    /** Remove the element at the front of the queue.  Returns false if the queue is empty */
+    bool pop(T &elem)
+    {
+        Cell *cell;
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &cells[pos & mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0)
+            {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false; // empty
+            else
+                pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+        elem = std::move(cell->data);
+        cell->data = T(); // release any resources held by the element now, not when the cell is reused
+        cell->seq.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Block until the queue is not empty or the timeout expires.  Nothing is removed from the queue, so
+     * another consumer may take the element before the caller does.  Returns true if the queue is not empty.
+     */
+    bool wait(std::chrono::milliseconds timeout)
+    {
+        if (!empty())
+            return true;
+
+        std::unique_lock<std::mutex> lock(cs_wait);
+        nWaiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool ret = cv_wait.wait_for(lock, timeout, [this] { return !empty(); });
+        nWaiters.fetch_sub(1, std::memory_order_relaxed);
+        return ret;
+    }
+
+    /** Wake up every consumer blocked in wait(), for example at shutdown */
+    void notify_all()
+    {
+        std::lock_guard<std::mutex> lock(cs_wait);
+        cv_wait.notify_all();
+    }
+
+    /** Discard all elements.  Returns the number of elements removed */
+    size_t clear()
+    {
+        size_t count = 0;
+        T elem;
+        while (pop(elem))
+            count++;
+        return count;
+    }
+
+    /** The number of elements in the queue.  This is only a snapshot if other threads are using the queue */
+    size_t size() const
+    {
+        size_t tail = dequeuePos.load(std::memory_order_acquire);
+        size_t head = enqueuePos.load(std::memory_order_acquire);
+        return (head > tail) ? head - tail : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask + 1; }
+};
+
+#endif
@@ -152,8 +152,9 @@ void FinalizeNode(NodeId nodeid)
     thinrelay.ClearAllBlocksToReconstruct(nodeid);
     thinrelay.ClearAllBlocksInFlight(nodeid);
 
-    // Clear Graphene blocks held by sender for this receiver
+    // Clear Graphene blocks held by sender for this receiver, and what was learned from how they decoded
     thinrelay.ClearSentGrapheneBlocks(nodeid);
+    graphenedata.RemovePeer(nodeid);
 
     // Update block sync counters
     {
@@ -734,10 +735,6 @@ void MainCleanup()
         mapBlockIndex.clear();
     }
 
-    {
-        // orphan transactions
-        WRITELOCK(orphanpool.cs_orphanpool);
-        orphanpool.mapOrphanTransactions.clear();
-        orphanpool.mapOrphanTransactionsByPrev.clear();
-    }
+    // orphan transactions
+    orphanpool.clear();
 }
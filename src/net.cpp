@@ -28,6 +28,7 @@
 #include "iblt.h"
 #include "primitives/transaction.h"
 #include "requestManager.h"
+#include "socketevents.h"
 #include "ui_interface.h"
 #include "unlimited.h"
 #include "utilstrencodings.h"
@@ -456,7 +457,7 @@ CNode *ConnectNode(CAddress addrConnect, const char *pszDest, bool fCountFailure
                       &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket))
+        if (!CSocketEvents::CanWaitOn(hSocket))
         {
             LOG(NET, "Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
@@ -842,7 +843,7 @@ int SocketSendData(CNode *pnode, bool fSendTwo = false) EXCLUSIVE_LOCKS_REQUIRED
     if (pnode->fDisconnect)
         return progress;
 
-    std::deque<CSerializeData>::iterator it;
+    std::deque<CSerializedNetMsgRef>::iterator it;
     while (!pnode->vSendMsg.empty() || !pnode->vLowPrioritySendMsg.empty())
     {
         if (!pnode->vSendMsg.empty())
@@ -860,12 +861,12 @@ int SocketSendData(CNode *pnode, bool fSendTwo = false) EXCLUSIVE_LOCKS_REQUIRED
             continue;
         }
 
-        const CSerializeData &data = *it;
+        const CSerializeData &data = **it;
         if (data.size() <= 0)
         {
-            pnode->vSendMsg.pop_front();
             LOGA("ERROR:  Trying to send message but data size was %d nSendOffset was %d nSendSize was %d\n",
                 data.size(), pnode->nSendOffset, pnode->nSendSize);
+            pnode->vSendMsg.pop_front();
             continue;
         }
         DbgAssert(data.size() > pnode->nSendOffset, );
@@ -1108,7 +1109,7 @@ static void AcceptConnection(const ListenSocket &hListenSocket)
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!CSocketEvents::CanWaitOn(hSocket))
     {
         LOG(NET, "connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1310,6 +1311,8 @@ void CleanupDisconnectedNodes()
 
 void ThreadSocketHandler()
 {
+    CSocketEvents socketEvents;
+    LOGA("Waiting for socket events with %s\n", socketEvents.UsesEpoll() ? "epoll" : "select");
     unsigned int nPrevNodeCount = 0;
     // This variable is incremented if something happens.  If it is zero at the bottom of the loop, we delay.  This
     // solves spin loop issues where the select does not block but no bytes can be transferred (traffic shaping limited,
@@ -1331,26 +1334,11 @@ void ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-        std::set<SOCKET> setSocket;
+        const int64_t nTimeoutMs = 50; // frequency to poll pnode->vSend
 
         for (const ListenSocket &hListenSocket : vhListenSocket)
         {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-            setSocket.insert(hListenSocket.socket);
+            socketEvents.Add(hListenSocket.socket, CSocketEvents::RECV);
         }
 
         {
@@ -1364,19 +1352,15 @@ void ThreadSocketHandler()
                 SOCKET hSocket = pnode->hSocket;
                 if (hSocket == INVALID_SOCKET)
                     continue;
-                FD_SET(hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, hSocket);
-                have_fds = true;
-                setSocket.insert(hSocket);
 
                 // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
+                // * If there is data to send, wait for sending data. As this only
                 //   happens when optimistic write failed, we choose to first drain the
                 //   write buffer in this case before receiving more. This avoids
                 //   needlessly queueing received data, if the remote peer is not themselves
                 //   receiving data. This means properly utilizing TCP flow control signalling.
                 // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
+                //   or there is space left in the buffer, wait for receiving data.
                 // * (if neither of the above applies, there is certainly one message
                 //   in the receiver buffer ready to be processed).
                 // Together, that means that at least one of the following is always possible,
@@ -1384,43 +1368,38 @@ void ThreadSocketHandler()
                 // * We send some data.
                 // * We wait for data to be received (and disconnect after timeout).
                 // * We process a message in the buffer (message handler thread).
+                int nEvents = 0;
                 {
                     TRY_LOCK(pnode->cs_vSend, lockSend);
                     if (lockSend && (!pnode->vSendMsg.empty() || !pnode->vLowPrioritySendMsg.empty()))
                     {
-                        FD_SET(hSocket, &fdsetSend);
-                        continue;
+                        nEvents = CSocketEvents::SEND;
                     }
                 }
+                if (nEvents == 0)
                 {
                     TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                     if (lockRecv && (pnode->vRecvMsg.empty() || pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
                     {
-                        FD_SET(hSocket, &fdsetRecv);
+                        nEvents = CSocketEvents::RECV;
                     }
                 }
+                // Errors are always waited for
+                socketEvents.Add(hSocket, nEvents, pnode->GetId());
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        int nReady = socketEvents.Wait(nTimeoutMs);
         if (shutdown_threads.load() == true)
         {
             return;
         }
 
-        if (nSelect == SOCKET_ERROR)
+        if (nReady == SOCKET_ERROR)
         {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LOG(NET, "socket select error %s\n", NetworkErrorString(nErr));
-
-                for (SOCKET hSocket : setSocket)
-                    FD_SET(hSocket, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec / 1000);
+            int nErr = WSAGetLastError();
+            LOG(NET, "socket %s error %s\n", socketEvents.UsesEpoll() ? "epoll" : "select", NetworkErrorString(nErr));
+            MilliSleep(nTimeoutMs);
         }
 
         //
@@ -1428,7 +1407,8 @@ void ThreadSocketHandler()
         //
         for (const ListenSocket &hListenSocket : vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET &&
+                (socketEvents.Ready(hListenSocket.socket) & CSocketEvents::RECV))
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1459,7 +1439,7 @@ void ThreadSocketHandler()
             SOCKET hSocket = pnode->hSocket;
             if (hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(hSocket, &fdsetRecv) || FD_ISSET(hSocket, &fdsetError))
+            if (socketEvents.Ready(hSocket) & (CSocketEvents::RECV | CSocketEvents::ERR))
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 int64_t amt2Recv = receiveShaper.available(RECV_SHAPER_MIN_FRAG);
@@ -1521,7 +1501,7 @@ void ThreadSocketHandler()
             hSocket = pnode->hSocket;
             if (hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(hSocket, &fdsetSend))
+            if (socketEvents.Ready(hSocket) & CSocketEvents::SEND)
             {
                 // Send priority messages if there any regardless of which peer, taking care to maintain
                 // locking orders.
@@ -3383,6 +3363,30 @@ CNode::~CNode()
     GetNodeSignals().FinalizeNode(GetId());
 }
 
+static void SetMessageSizeAndChecksum(CDataStream &ssMsg, bool fSkipChecksum)
+{
+    assert(ssMsg.size() >= CMessageHeader::HEADER_SIZE);
+    unsigned int nSize = ssMsg.size() - CMessageHeader::HEADER_SIZE;
+    WriteLE32((uint8_t *)&ssMsg[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
+
+    uint32_t nChecksum = 0;
+    if (!fSkipChecksum)
+    {
+        uint256 hash = Hash(ssMsg.begin() + CMessageHeader::HEADER_SIZE, ssMsg.end());
+        memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    }
+    memcpy((char *)&ssMsg[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+}
+
+CSerializedNetMsgRef FinalizeNetMessage(CDataStream &ssMsg)
+{
+    // Always checksum a shared message, since it may go to peers that do not let us skip the checksum
+    SetMessageSizeAndChecksum(ssMsg, false);
+    CSerializeData data;
+    ssMsg.GetAndClear(data);
+    return std::make_shared<const CSerializeData>(std::move(data));
+}
+
 void CNode::BeginMessage(const char *pszCommand) EXCLUSIVE_LOCK_FUNCTION(cs_vSend)
 {
     ENTER_CRITICAL_SECTION(cs_vSend);
@@ -3418,31 +3422,47 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
         LEAVE_CRITICAL_SECTION(cs_vSend);
         return;
     }
-    // Set the size
-    unsigned int nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
-    WriteLE32((uint8_t *)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
+    // Set the size and the checksum.  If we can skip the checksum, we send 0 instead
+    SetMessageSizeAndChecksum(ssSend, skipChecksum);
+    CSerializeData data;
+    ssSend.GetAndClear(data);
+    LOG(NET, "(%d bytes) peer=%d\n", data.size() - CMessageHeader::HEADER_SIZE, id);
 
-    UpdateSendStats(this, currentCommand, nSize + CMessageHeader::HEADER_SIZE, GetTimeMicros());
+    QueueMessage(std::make_shared<const CSerializeData>(std::move(data)));
+
+    LEAVE_CRITICAL_SECTION(cs_vSend);
+}
 
-    // Set the checksum
-    uint32_t nChecksum = 0; // If we can skip the checksum, we send 0 instead
-    if (!skipChecksum)
+void CNode::PushSharedMessage(const CSerializedNetMsgRef &msgShared)
+{
+    LOCK(cs_vSend);
+    assert(ssSend.size() == 0);
+    if (mapArgs.count("-dropmessagestest") && GetRand(GetArg("-dropmessagestest", 2)) == 0)
     {
-        uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
-        memcpy(&nChecksum, &hash, sizeof(nChecksum));
+        LOG(NET, "dropmessages DROPPING SEND MESSAGE\n");
+        return;
     }
-    assert(ssSend.size() >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
-    memcpy((char *)&ssSend[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+    // Shared messages are not fuzzed by -fuzzmessagestest, since every peer they are queued on would see the change
+    LOG(NET, "sending shared msg (%d bytes) to %s\n", msgShared->size() - CMessageHeader::HEADER_SIZE,
+        GetLogName());
+    QueueMessage(msgShared);
+}
+
+void CNode::QueueMessage(const CSerializedNetMsgRef &msgData)
+{
+    AssertLockHeld(cs_vSend);
+    assert(msgData->size() >= CMessageHeader::HEADER_SIZE);
+    unsigned int nSize = msgData->size() - CMessageHeader::HEADER_SIZE;
+
+    char strCommand[CMessageHeader::COMMAND_SIZE + 1];
+    strncpy(strCommand, &(*msgData)[MESSAGE_START_SIZE], CMessageHeader::COMMAND_SIZE);
+    strCommand[CMessageHeader::COMMAND_SIZE] = '\0';
 
-    LOG(NET, "(%d bytes) peer=%d\n", nSize, id);
+    UpdateSendStats(this, strCommand, msgData->size(), GetTimeMicros());
 
     // Connection slot attack mitigation.  We don't want to add useful bytes for outgoing INV, PING, ADDR,
     // VERSION or VERACK messages since attackers will often just connect and listen to INV messages.
     // We want to make sure that connected nodes are doing useful work in sending us data or requesting data.
-    std::deque<CSerializeData>::iterator it;
-    char strCommand[CMessageHeader::COMMAND_SIZE + 1];
-    strncpy(strCommand, &(*(ssSend.begin() + MESSAGE_START_SIZE)), CMessageHeader::COMMAND_SIZE);
-    strCommand[CMessageHeader::COMMAND_SIZE] = '\0';
     if (strcmp(strCommand, NetMsgType::PING) != 0 && strcmp(strCommand, NetMsgType::PONG) != 0 &&
         strcmp(strCommand, NetMsgType::ADDR) != 0 && strcmp(strCommand, NetMsgType::VERSION) != 0 &&
         strcmp(strCommand, NetMsgType::VERACK) != 0 && strcmp(strCommand, NetMsgType::INV) != 0)
@@ -3451,11 +3471,10 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     }
 
     // If the message is a priority message then move it to priority queue.
+    nSendSize.fetch_add(msgData->size());
     if (IsPriorityMsg(strCommand))
     {
-        it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-        ssSend.GetAndClear(*it);
-        nSendSize.fetch_add((*it).size());
+        vSendMsg.push_back(msgData);
         LOG(PRIORITYQ, "Send Queue: pushed %s to the priority queue, peer(%d)\n", strCommand, this->GetId());
 
         LOCK(cs_prioritySendQ);
@@ -3464,9 +3483,7 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     }
     else
     {
-        it = vLowPrioritySendMsg.insert(vLowPrioritySendMsg.end(), CSerializeData());
-        ssSend.GetAndClear(*it);
-        nSendSize.fetch_add((*it).size());
+        vLowPrioritySendMsg.push_back(msgData);
     }
 
     // if only 1 message is in queue then attempt and "optimistic" send
@@ -3478,8 +3495,6 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     {
         SocketSendData(this);
     }
-
-    LEAVE_CRITICAL_SECTION(cs_vSend);
 }
 
 /**
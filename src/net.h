@@ -33,6 +33,7 @@
 
 #include <atomic>
 #include <deque>
+#include <memory>
 #include <stdint.h>
 
 #ifndef WIN32
@@ -122,6 +123,26 @@ unsigned int SendBufferSize();
 // sentinel value.
 typedef int NodeId;
 
+/**
+ * A complete network message, header included, as it is put on the wire.  It is never modified once it is built, so
+ * the same message can be queued for sending to any number of peers.
+ */
+typedef std::shared_ptr<const CSerializeData> CSerializedNetMsgRef;
+
+/** Set the size and checksum in the header of a message serialized into ssMsg, and take the message out of ssMsg */
+CSerializedNetMsgRef FinalizeNetMessage(CDataStream &ssMsg);
+
+/** Serialize a message once so that it can be sent to several peers with CNode::PushSharedMessage */
+template <typename T>
+CSerializedNetMsgRef MakeNetMessage(const CMessageHeader::MessageStartChars &magic,
+    const char *pszCommand,
+    const T &payload)
+{
+    CDataStream ssMsg(SER_NETWORK, INIT_PROTO_VERSION);
+    ssMsg << CMessageHeader(magic, pszCommand, 0) << payload;
+    return FinalizeNetMessage(ssMsg);
+}
+
 void AddOneShot(const std::string &strDest);
 // Find a node by name.  Returns a null ref if no node found
 CNodeRef FindNodeRef(const std::string &addrName);
@@ -390,8 +411,8 @@ public:
     CDataStream ssSend GUARDED_BY(cs_vSend);
     size_t nSendOffset GUARDED_BY(cs_vSend); // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend);
-    std::deque<CSerializeData> vSendMsg GUARDED_BY(cs_vSend);
-    std::deque<CSerializeData> vLowPrioritySendMsg GUARDED_BY(cs_vSend);
+    std::deque<CSerializedNetMsgRef> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<CSerializedNetMsgRef> vLowPrioritySendMsg GUARDED_BY(cs_vSend);
     std::atomic<uint64_t> nSendSize; // total size in bytes of all vSendMsg entries
 
     CCriticalSection csRecvGetData;
@@ -529,6 +550,9 @@ protected:
     // Basic fuzz-testing
     void Fuzz(int nChance); // modifies ssSend
 
+    // Put a finished message on the send queue that it belongs in, and try to send it right away
+    void QueueMessage(const CSerializedNetMsgRef &msgData) EXCLUSIVE_LOCKS_REQUIRED(cs_vSend);
+
 public:
 #ifdef DEBUG
     friend UniValue getstructuresizes(const UniValue &params, bool fHelp);
@@ -778,6 +802,12 @@ public:
     // TODO: Document the precondition of this function.  Is cs_vSend locked?
     void EndMessage() UNLOCK_FUNCTION(cs_vSend);
 
+    /**
+     * Queue a message that was built with MakeNetMessage.  The message is shared rather than copied, so a message
+     * that goes to many peers is only serialized and checksummed once.
+     */
+    void PushSharedMessage(const CSerializedNetMsgRef &msgShared);
+
     void PushVersion();
 
 
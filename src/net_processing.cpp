@@ -188,27 +188,41 @@ void static ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParam
                 if (fSend && mi->nStatus & BLOCK_HAVE_DATA)
                 {
                     // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, mi, consensusParams))
+                    bool fRead = false;
+                    if (inv.type == MSG_BLOCK)
                     {
-                        // its possible that I know about it but haven't stored it yet
-                        LOG(THIN, "unable to load block %s from disk\n",
-                            mi->phashBlock ? mi->phashBlock->ToString() : "");
-                        // no response
-                    }
-                    else
-                    {
-                        if (inv.type == MSG_BLOCK)
+                        // A new block is asked for by many peers, so they are all sent the same message
+                        const CMessageHeader::MessageStartChars &magic = pfrom->GetMagic(Params());
+                        CSerializedNetMsgRef msg = thinrelay.GetRecentBlockMessage(inv.hash, magic);
+                        if (!msg)
+                        {
+                            // The stored block is already in the wire format, so its bytes are sent as they are,
+                            // without deserializing and serializing it again
+                            CBlockFileView view;
+                            if (ReadRawBlockFromDisk(view, mi, Params()))
+                            {
+                                msg = MakeNetMessage(magic, NetMsgType::BLOCK, view);
+                                if (chainActive.Height() - mi->nHeight < (int)ThinTypeRelay::MAX_RECENT_BLOCK_MSGS)
+                                    thinrelay.AddRecentBlockMessage(inv.hash, msg);
+                            }
+                        }
+                        fRead = (msg != nullptr);
+                        if (fRead)
                         {
                             pfrom->blocksSent += 1;
-                            pfrom->PushMessage(NetMsgType::BLOCK, block);
+                            pfrom->PushSharedMessage(msg);
                         }
-                        else if (inv.type == MSG_CMPCT_BLOCK)
+                    }
+                    else
+                    {
+                        CBlock block;
+                        fRead = ReadBlockFromDisk(block, mi, consensusParams);
+                        if (fRead && inv.type == MSG_CMPCT_BLOCK)
                         {
                             LOG(CMPCT, "Sending compactblock via getdata message\n");
                             SendCompactBlock(MakeBlockRef(block), pfrom, inv);
                         }
-                        else // MSG_FILTERED_BLOCK)
+                        else if (fRead) // MSG_FILTERED_BLOCK)
                         {
                             LOCK(pfrom->cs_filter);
                             if (pfrom->pfilter)
@@ -234,18 +248,25 @@ void static ProcessGetData(CNode *pfrom, const Consensus::Params &consensusParam
                             // else
                             // no response
                         }
+                    }
 
-                        // Trigger the peer node to send a getblocks request for the next batch of inventory
-                        if (inv.hash == pfrom->hashContinue)
-                        {
-                            // Bypass PushInventory, this must send even if redundant,
-                            // and we want it right after the last block so they don't
-                            // wait for other stuff first.
-                            std::vector<CInv> oneInv;
-                            oneInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
-                            pfrom->PushMessage(NetMsgType::INV, oneInv);
-                            pfrom->hashContinue.SetNull();
-                        }
+                    if (!fRead)
+                    {
+                        // its possible that I know about it but haven't stored it yet
+                        LOG(THIN, "unable to load block %s from disk\n",
+                            mi->phashBlock ? mi->phashBlock->ToString() : "");
+                        // no response
+                    }
+                    // Trigger the peer node to send a getblocks request for the next batch of inventory
+                    else if (inv.hash == pfrom->hashContinue)
+                    {
+                        // Bypass PushInventory, this must send even if redundant,
+                        // and we want it right after the last block so they don't
+                        // wait for other stuff first.
+                        std::vector<CInv> oneInv;
+                        oneInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
+                        pfrom->PushMessage(NetMsgType::INV, oneInv);
+                        pfrom->hashContinue.SetNull();
                     }
                 }
             }
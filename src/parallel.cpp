@@ -44,10 +44,10 @@ static void AddScriptCheckThreads(int i, CCheckQueue<CScriptCheck> *pqueue)
     pqueue->Thread();
 }
 
-bool CScriptCheck::operator()()
+bool CScriptCheck::operator()(CSignatureBatch *batch)
 {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
-    CachingTransactionSignatureChecker checker(ptxTo, nIn, amount, nFlags, cacheStore);
+    CachingTransactionSignatureChecker checker(ptxTo, nIn, amount, nFlags, cacheStore, txdata.get(), batch);
     ScriptMachineResourceTracker smRes;
     if (!VerifyScript(scriptSig, scriptPubKey, nFlags, maxOps, checker, &error, &smRes))
     {
@@ -75,6 +75,33 @@ bool CScriptCheck::operator()()
     return true;
 }
 
+bool CheckBatch(std::vector<CScriptCheck> &vChecks)
+{
+    // A single check has nothing to share a batch with
+    if (vChecks.size() < 2)
+        return vChecks.empty() || vChecks[0]();
+
+    CSignatureBatch batch;
+    for (CScriptCheck &check : vChecks)
+    {
+        if (!check(&batch))
+            return false;
+    }
+    if (batch.Verify())
+        return true;
+
+    // At least one signature in the batch is bad, find out which script it belongs to.  The first pass already
+    // counted the sigops and sigchecks of every script, so do not count them again.
+    LOG(PARALLEL, "Schnorr batch verification of %d signatures failed, checking scripts one by one\n", batch.size());
+    for (CScriptCheck &check : vChecks)
+    {
+        check.resourceTracker = nullptr;
+        if (!check())
+            return false;
+    }
+    return true;
+}
+
 CParallelValidation::CParallelValidation() : nThreads(0), semThreadCount(nScriptCheckQueues)
 {
     // There are nScriptCheckQueues which are used to validate blocks in parallel. Each block
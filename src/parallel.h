@@ -14,6 +14,7 @@
 #include "stat.h"
 #include "uint256.h"
 #include "util.h"
+#include <memory>
 #include <vector>
 
 #include <thread>
@@ -81,6 +82,8 @@ public:
     }
 };
 
+class CSignatureBatch;
+
 /**
  * Closure representing one script verification
  * Note that this stores references to the spending transaction
@@ -97,6 +100,8 @@ protected:
     unsigned int maxOps;
     bool cacheStore;
     ScriptError error;
+    //! Sighash midstate shared by the checks of all inputs of ptxTo
+    std::shared_ptr<const PrecomputedTransactionData> txdata;
 
 public:
     unsigned char sighashType;
@@ -113,14 +118,19 @@ public:
         unsigned int nInIn,
         unsigned int nFlagsIn,
         unsigned int maxOpsIn,
-        bool cacheIn)
+        bool cacheIn,
+        const std::shared_ptr<const PrecomputedTransactionData> &txdataIn = nullptr)
         : resourceTracker(resourceTrackerIn), scriptPubKey(scriptPubKeyIn), amount(amountIn), ptxTo(&txToIn),
           nIn(nInIn), nFlags(nFlagsIn), maxOps(maxOpsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR),
-          sighashType(0)
+          txdata(txdataIn), sighashType(0)
     {
     }
 
-    bool operator()();
+    /**
+     * Run the script.  If a batch is given, Schnorr signatures are added to it rather than verified, so the
+     * check has only passed once the batch has been verified as well.
+     */
+    bool operator()(CSignatureBatch *batch = nullptr);
 
     void swap(CScriptCheck &check)
     {
@@ -134,11 +144,22 @@ public:
         std::swap(error, check.error);
         std::swap(sighashType, check.sighashType);
         std::swap(maxOps, check.maxOps);
+        std::swap(txdata, check.txdata);
     }
 
     ScriptError GetScriptError() const { return error; }
+
+    friend bool CheckBatch(std::vector<CScriptCheck> &vChecks);
 };
 
+/**
+ * Run a batch of script checks, verifying all their Schnorr signatures together.  If the signature batch
+ * fails the checks are run again one by one, so that the failing input is still identified.  The resource
+ * tracker is only updated by the first pass.
+ * This overload is picked up by CCheckQueue<CScriptCheck>.
+ */
+bool CheckBatch(std::vector<CScriptCheck> &vChecks);
+
 class CParallelValidation
 {
 public:
@@ -134,7 +134,8 @@ public:
     inline void SerializationOp(Stream &s, Operation ser_action)
     {
         READWRITE(*(CBlockHeader *)this);
-        READWRITE(vtx);
+        // Hashing every transaction is a large part of deserializing a block, so do it as one parallel batch
+        SerReadWriteTransactions(s, vtx, ser_action);
     }
 
     uint64_t GetHeight() const // Returns the block's height as specified in its coinbase transaction
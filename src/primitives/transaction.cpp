@@ -10,6 +10,7 @@
 #include "policy/policy.h"
 #include "tinyformat.h"
 #include "utilstrencodings.h"
+#include "workerpool.h"
 
 
 std::string COutPoint::ToString() const { return strprintf("COutPoint(%s, %u)", hash.ToString().substr(0, 10), n); }
@@ -76,6 +77,12 @@ CTransaction::CTransaction(CMutableTransaction &&tx)
     UpdateHash();
 }
 
+CTransaction::CTransaction(CMutableTransaction &&tx, const uint256 &hashIn)
+    : hash(hashIn), nTxSize(0), nVersion(tx.nVersion), vin(std::move(tx.vin)), vout(std::move(tx.vout)),
+      nLockTime(tx.nLockTime)
+{
+}
+
 CTransaction::CTransaction(const CTransaction &tx)
     : nTxSize(tx.nTxSize.load()), nVersion(tx.nVersion), vin(tx.vin), vout(tx.vout), nLockTime(tx.nLockTime)
 {
@@ -187,3 +194,35 @@ bool CTransaction::HasData(uint32_t dataID) const
     }
     return false;
 }
+
+/** Below this many transactions per task, handing the work to another thread costs more than it saves */
+static const size_t MIN_TXS_PER_HASH_TASK = 500;
+
+void MakeTransactionRefs(std::vector<CMutableTransaction> &txs, std::vector<CTransactionRef> &vtx)
+{
+    const size_t nTxs = txs.size();
+    vtx.clear();
+    vtx.resize(nTxs);
+
+    // Each task converts its own range, so there is nothing to synchronize
+    auto convert = [&txs, &vtx](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            uint256 hash = txs[i].GetHash();
+            vtx[i] = std::make_shared<const CTransaction>(std::move(txs[i]), hash);
+        }
+    };
+
+    CWorkerPool &pool = GetWorkerPool();
+    const size_t nTasks = std::min(pool.Concurrency(), nTxs / MIN_TXS_PER_HASH_TASK);
+    if (nTasks <= 1)
+    {
+        convert(0, nTxs);
+        return;
+    }
+
+    const size_t nChunk = (nTxs + nTasks - 1) / nTasks;
+    pool.ForEach(nTasks, [&convert, nChunk, nTxs](size_t n) {
+        convert(std::min(n * nChunk, nTxs), std::min((n + 1) * nChunk, nTxs));
+    });
+}
@@ -13,6 +13,7 @@
 #include "tweak.h"
 #include "uint256.h"
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 
@@ -205,6 +206,8 @@ public:
     /** Convert a CMutableTransaction into a CTransaction. */
     CTransaction(const CMutableTransaction &tx);
     CTransaction(CMutableTransaction &&tx);
+    /** Convert a CMutableTransaction whose hash the caller has already computed. hashIn must equal tx.GetHash() */
+    CTransaction(CMutableTransaction &&tx, const uint256 &hashIn);
 
     CTransaction(const CTransaction &tx);
     CTransaction &operator=(const CTransaction &tx);
@@ -315,4 +318,38 @@ static inline CTransactionRef MakeTransactionRef(Tx &&txIn)
 {
     return std::make_shared<const CTransaction>(std::forward<Tx>(txIn));
 }
+
+/**
+ * Convert a batch of transactions into CTransactionRefs, replacing the contents of vtx.  Computing the txids
+ * is most of the work, so large batches (the transactions of a big block) are hashed on the shared worker pool.
+ * The contents of txs are moved out.
+ */
+void MakeTransactionRefs(std::vector<CMutableTransaction> &txs, std::vector<CTransactionRef> &vtx);
+
+/** Deserialize a vector of transactions, computing their txids in parallel.  See MakeTransactionRefs */
+template <typename Stream>
+void UnserializeTransactions(Stream &s, std::vector<CTransactionRef> &vtx)
+{
+    vtx.clear();
+    unsigned int nSize = ReadCompactSize(s);
+    std::vector<CMutableTransaction> txs;
+    // Like the generic vector deserializer, do not trust the size enough to allocate all of it up front
+    txs.reserve(std::min<size_t>(nSize, 5000000 / sizeof(CMutableTransaction)));
+    for (unsigned int i = 0; i < nSize; i++)
+        txs.emplace_back(deserialize, s);
+    MakeTransactionRefs(txs, vtx);
+}
+
+/** READWRITE for the transactions of a block: deserializing goes through UnserializeTransactions */
+template <typename Stream>
+inline void SerReadWriteTransactions(Stream &s, std::vector<CTransactionRef> &vtx, CSerActionSerialize)
+{
+    ::Serialize(s, vtx);
+}
+
+template <typename Stream>
+inline void SerReadWriteTransactions(Stream &s, std::vector<CTransactionRef> &vtx, CSerActionUnserialize)
+{
+    UnserializeTransactions(s, vtx);
+}
 #endif // BITCOIN_PRIMITIVES_TRANSACTION_H
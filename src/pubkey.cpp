@@ -260,6 +260,84 @@ bool CPubKey::VerifySchnorr(const uint256 &hash, const std::vector<uint8_t> &vch
     return secp256k1_schnorr_verify(secp256k1_context_verify, &vchSig[0], hash.begin(), &pubkey);
 }
 
+//! Scratch space for the multi-multiplication, enough for a full chunk of the batch verifier
+static const size_t SCHNORR_BATCH_SCRATCH_SIZE = 1 << 20;
+
+namespace
+{
+/**
+ * Scratch space for batch verification, allocated on first use and reused by every later batch verified on
+ * the same thread.  The scratch space only uses the context for its error callback, so use the static context:
+ * it can not go away while we are using it.
+ */
+class CSchnorrBatchScratch
+{
+public:
+    secp256k1_scratch_space *scratch;
+
+    CSchnorrBatchScratch()
+        : scratch(secp256k1_scratch_space_create(secp256k1_context_no_precomp, SCHNORR_BATCH_SCRATCH_SIZE))
+    {
+    }
+    ~CSchnorrBatchScratch()
+    {
+        if (scratch)
+            secp256k1_scratch_space_destroy(secp256k1_context_no_precomp, scratch);
+    }
+};
+} // namespace
+
+bool CSchnorrBatch::Add(const CPubKey &pubkey, const uint256 &hash, const std::vector<uint8_t> &vchSig)
+{
+    static_assert(sizeof(secp256k1_pubkey) == 64, "unexpected secp256k1_pubkey size");
+    if (!pubkey.IsValid() || vchSig.size() != 64)
+    {
+        return false;
+    }
+
+    secp256k1_pubkey parsed;
+    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &parsed, &pubkey[0], pubkey.size()))
+    {
+        return false;
+    }
+
+    vPubKeys.emplace_back();
+    memcpy(vPubKeys.back().data(), &parsed, sizeof(parsed));
+    vHashes.push_back(hash);
+    vSigs.emplace_back();
+    memcpy(vSigs.back().data(), &vchSig[0], 64);
+    return true;
+}
+
+bool CSchnorrBatch::Verify() const
+{
+    if (vSigs.empty())
+    {
+        return true;
+    }
+
+    std::vector<const unsigned char *> sigs(vSigs.size());
+    std::vector<const unsigned char *> msgs(vSigs.size());
+    std::vector<const secp256k1_pubkey *> pubkeys(vSigs.size());
+    for (size_t i = 0; i < vSigs.size(); i++)
+    {
+        sigs[i] = vSigs[i].data();
+        msgs[i] = vHashes[i].begin();
+        pubkeys[i] = reinterpret_cast<const secp256k1_pubkey *>(vPubKeys[i].data());
+    }
+
+    static thread_local CSchnorrBatchScratch batchScratch;
+    int ret = secp256k1_schnorr_verify_batch(
+        secp256k1_context_verify, batchScratch.scratch, &sigs[0], &msgs[0], &pubkeys[0], vSigs.size());
+    return ret == 1;
+}
+
+bool CSchnorrBatch::VerifyOne(size_t n) const
+{
+    return secp256k1_schnorr_verify(secp256k1_context_verify, vSigs[n].data(), vHashes[n].begin(),
+               reinterpret_cast<const secp256k1_pubkey *>(vPubKeys[n].data())) == 1;
+}
+
 bool CPubKey::RecoverCompact(const uint256 &hash, const std::vector<uint8_t> &vchSig)
 {
     if (vchSig.size() != COMPACT_SIGNATURE_SIZE)
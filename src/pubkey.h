@@ -11,6 +11,7 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <array>
 #include <stdexcept>
 #include <vector>
 
@@ -181,6 +182,41 @@ public:
     bool Derive(CPubKey &pubkeyChild, ChainCode &ccChild, unsigned int nChild, const ChainCode &cc) const;
 };
 
+/**
+ * A set of Schnorr signatures that are verified together.  Batch verification is considerably faster than
+ * verifying each signature on its own, but a failed batch does not tell which signature is invalid.
+ */
+class CSchnorrBatch
+{
+private:
+    //! Public keys, already parsed into libsecp256k1's internal representation
+    std::vector<std::array<unsigned char, 64> > vPubKeys;
+    std::vector<uint256> vHashes;
+    std::vector<std::array<unsigned char, 64> > vSigs;
+
+public:
+    /**
+     * Add a signature to the batch.  Returns false, and adds nothing, if the signature can not be valid
+     * because the public key is not fully valid or the signature is not 64 bytes.
+     */
+    bool Add(const CPubKey &pubkey, const uint256 &hash, const std::vector<uint8_t> &vchSig);
+
+    /** Verify every signature in the batch.  Returns true if they are all valid (or the batch is empty) */
+    bool Verify() const;
+
+    /** Verify only the n-th signature of the batch, to find out which one made the batch fail */
+    bool VerifyOne(size_t n) const;
+
+    size_t size() const { return vSigs.size(); }
+    bool empty() const { return vSigs.empty(); }
+    void clear()
+    {
+        vPubKeys.clear();
+        vHashes.clear();
+        vSigs.clear();
+    }
+};
+
 struct CExtPubKey
 {
     unsigned char nDepth;
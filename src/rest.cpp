@@ -542,6 +542,9 @@ static bool rest_getutxos(HTTPRequest *req, const std::string &strURIPart)
     std::string bitmapStringRepresentation;
     std::vector<bool> hits;
     bitmap.resize((vOutPoints.size() + 7) / 8);
+    // Read the coins that are not cached yet in one batch, rather than one at a time in the loop below
+    if (fCheckMemPool)
+        pcoinsTip->GetCoinsFromDB(vOutPoints);
     {
         READLOCK(mempool.cs_txmempool);
 
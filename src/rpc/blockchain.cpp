@@ -13,7 +13,9 @@
 #include "checkpoints.h"
 #include "coins.h"
 #include "consensus/validation.h"
+#include "dstencode.h"
 #include "hashwrapper.h"
+#include "init.h"
 #include "main.h"
 #include "policy/policy.h"
 #include "primitives/transaction.h"
@@ -29,11 +31,15 @@
 #include "undo.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "utxosnapshot.h"
 #include "validation/validation.h"
 #include "validation/verifydb.h"
 
 #include <stdint.h>
 
+#include <condition_variable>
+#include <mutex>
+
 #include <univalue.h>
 
 #include <boost/algorithm/string.hpp>
@@ -867,7 +873,7 @@ static UniValue getblock(const UniValue &params, bool fHelp)
 }
 
 static void ApplyStats(CCoinsStats &stats,
-    CHashWriter &ss,
+    CDataStream &ss,
     const uint256 &hash,
     const std::map<uint32_t, Coin> &outputs)
 {
@@ -887,46 +893,168 @@ static void ApplyStats(CCoinsStats &stats,
     ss << VARINT(0u);
 }
 
-//! Calculate statistics about the unspent transaction output set
-static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
+/**
+ * The number of ranges that full scans of the UTXO set are split into, so that they can be walked in parallel.  It
+ * does not depend on the number of cores, so that the serialized hash of the set is the same on every node.
+ */
+static const unsigned int UTXO_SCAN_RANGES = 64;
+
+/**
+ * Hashes the serialized coins of the ranges of a UTXO set scan as one stream, in range order, which gives the
+ * hash_serialized_2 of a sequential walk.  The range whose turn it is hashes its coins as it reads them.  The
+ * ranges after it buffer theirs, and once a range has buffered MAX_PENDING bytes it waits for its turn, which
+ * bounds the memory a scan uses.
+ */
+class CSerializedRangesHasher
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    DbgAssert(pcursor, throw std::runtime_error(__func__));
+    static const size_t MAX_PENDING = 16 << 20;
 
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
+    std::mutex cs;
+    std::condition_variable cv;
+    //! The range that may write to ss.  Guarded by cs
+    unsigned int nTurn = 0;
+    //! Set if a range did not finish, so the ranges after it will never get their turn.  Guarded by cs
+    bool fAbort = false;
+    CHashWriter ss;
 
-    CBlockIndex *pindex = LookupBlockIndex(stats.hashBlock);
-    stats.nHeight = pindex->nHeight;
-    ss << stats.hashBlock;
-    uint256 prevkey;
-    std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid())
-    {
-        boost::this_thread::interruption_point();
-        COutPoint key;
-        Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin))
+public:
+    CSerializedRangesHasher() : ss(SER_GETHASH, PROTOCOL_VERSION) {}
+    uint256 GetHash() { return ss.GetHash(); }
+
+    class Range
+    {
+        CSerializedRangesHasher &hasher;
+        const unsigned int nRange;
+        bool fTurn = false;
+        bool fDone = false;
+        std::vector<char> vPending;
+
+        bool WaitForTurn()
         {
-            if (!outputs.empty() && key.hash != prevkey)
             {
-                ApplyStats(stats, ss, prevkey, outputs);
-                outputs.clear();
+                std::unique_lock<std::mutex> lock(hasher.cs);
+                hasher.cv.wait(lock, [this] { return hasher.nTurn == nRange || hasher.fAbort; });
+                if (hasher.fAbort)
+                    return false;
             }
-            prevkey = key.hash;
-            outputs[key.n] = std::move(coin);
+            fTurn = true;
+            hasher.ss.write(vPending.data(), vPending.size());
+            std::vector<char>().swap(vPending);
+            return true;
         }
-        else
+
+    public:
+        Range(CSerializedRangesHasher &hasherIn, unsigned int nRangeIn) : hasher(hasherIn), nRange(nRangeIn) {}
+        ~Range()
         {
-            return error("%s: unable to read value", __func__);
+            if (fDone)
+                return;
+            {
+                std::lock_guard<std::mutex> lock(hasher.cs);
+                hasher.fAbort = true;
+            }
+            hasher.cv.notify_all();
         }
-        pcursor->Next();
-    }
-    if (!outputs.empty())
+
+        //! Add the next coins of the range.  Returns false if the scan was aborted
+        bool Write(const char *pch, size_t nSize)
+        {
+            if (fTurn)
+            {
+                hasher.ss.write(pch, nSize);
+                return true;
+            }
+            vPending.insert(vPending.end(), pch, pch + nSize);
+            return vPending.size() < MAX_PENDING || WaitForTurn();
+        }
+
+        //! End the range and pass the turn on.  Returns false if the scan was aborted
+        bool Finish()
+        {
+            if (!fTurn && !WaitForTurn())
+                return false;
+            {
+                std::lock_guard<std::mutex> lock(hasher.cs);
+                hasher.nTurn++;
+                fDone = true;
+            }
+            hasher.cv.notify_all();
+            return true;
+        }
+    };
+};
+
+//! Calculate statistics about the unspent transaction output set
+static bool GetUTXOStats(CCoinsViewDB *view, CCoinsStats &stats)
+{
+    std::vector<CCoinsStats> rangeStats(UTXO_SCAN_RANGES);
+    std::vector<uint256> rangeHashes(UTXO_SCAN_RANGES);
+    CSerializedRangesHasher serialized;
+    CECMultiSet commitment;
+    bool fOk = view->ForEachCoinRange(UTXO_SCAN_RANGES,
+        [&rangeStats, &rangeHashes, &serialized](CCoinsViewCursor &cursor, unsigned int nRange) {
+            CSerializedRangesHasher::Range ordered(serialized, nRange);
+            CCoinsStats &s = rangeStats[nRange];
+            s.hashBlock = cursor.GetBestBlock();
+            CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+            CDataStream tx(SER_GETHASH, PROTOCOL_VERSION);
+            if (nRange == 0)
+            {
+                // The serialized set starts with the best block
+                tx << s.hashBlock;
+                ordered.Write(tx.data(), tx.size());
+            }
+            auto apply = [&s, &ss, &tx, &ordered](const uint256 &hash, const std::map<uint32_t, Coin> &outputs) {
+                tx.clear();
+                ApplyStats(s, tx, hash, outputs);
+                ss.write(tx.data(), tx.size());
+                return ordered.Write(tx.data(), tx.size());
+            };
+            uint256 prevkey;
+            std::map<uint32_t, Coin> outputs;
+            while (cursor.Valid())
+            {
+                if (ShutdownRequested())
+                    return false;
+                COutPoint key;
+                Coin coin;
+                if (!cursor.GetKey(key) || !cursor.GetValue(coin))
+                    return error("%s: unable to read value", __func__);
+                if (!outputs.empty() && key.hash != prevkey)
+                {
+                    if (!apply(prevkey, outputs))
+                        return false;
+                    outputs.clear();
+                }
+                prevkey = key.hash;
+                outputs[key.n] = std::move(coin);
+                cursor.Next();
+            }
+            if (!outputs.empty() && !apply(prevkey, outputs))
+                return false;
+            rangeHashes[nRange] = ss.GetHash();
+            return ordered.Finish();
+        },
+        &commitment, &stats.fHaveUtxoCommitment);
+    if (!fOk)
+        return false;
+
+    stats.hashBlock = rangeStats[0].hashBlock;
+    CBlockIndex *pindex = LookupBlockIndex(stats.hashBlock);
+    stats.nHeight = pindex ? pindex->nHeight : -1;
+    if (stats.fHaveUtxoCommitment)
+        stats.hashUtxoCommitment = commitment.GetHash();
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << stats.hashBlock;
+    for (unsigned int n = 0; n < UTXO_SCAN_RANGES; n++)
     {
-        ApplyStats(stats, ss, prevkey, outputs);
+        ss << rangeHashes[n];
+        stats.nTransactions += rangeStats[n].nTransactions;
+        stats.nTransactionOutputs += rangeStats[n].nTransactionOutputs;
+        stats.nTotalAmount += rangeStats[n].nTotalAmount;
     }
-    stats.hashSerialized = ss.GetHash();
+    stats.hashSerialized = serialized.GetHash();
+    stats.hashSerializedRanges = ss.GetHash();
     stats.nDiskSize = view->EstimateSize();
     return true;
 }
@@ -934,25 +1062,47 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
 
 UniValue gettxoutsetinfo(const UniValue &params, bool fHelp)
 {
-    if (fHelp || params.size() != 0)
-        throw runtime_error("gettxoutsetinfo\n"
-                            "\nReturns statistics about the unspent transaction output set.\n"
-                            "Note this call may take some time.\n"
-                            "\nResult:\n"
-                            "{\n"
-                            "  \"height\":n,     (numeric) The current block height (index)\n"
-                            "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-                            "  \"transactions\": n,      (numeric) The number of transactions\n"
-                            "  \"txouts\": n,            (numeric) The number of output transactions\n"
-                            "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
-                            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
-                            "  \"total_amount\": x.xxx          (numeric) The total amount\n"
-                            "}\n"
-                            "\nExamples:\n" +
-                            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleRpc("gettxoutsetinfo", ""));
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "gettxoutsetinfo ( fast )\n"
+            "\nReturns statistics about the unspent transaction output set.\n"
+            "Note this call may take some time, unless fast is true.\n"
+            "\nArguments:\n"
+            "1. fast    (boolean, optional, default=false) Only return the height, the best block and the UTXO set\n"
+            "           commitment, which takes constant time, rather than walk the whole UTXO set\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"height\":n,     (numeric) The current block height (index)\n"
+            "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
+            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"txouts\": n,            (numeric) The number of output transactions\n"
+            "  \"hash_serialized_2\": \"hash\", (string) The hash of the serialized UTXO set\n"
+            "  \"hash_serialized_3\": \"hash\", (string) The hash of the serialized UTXO set, which is hashed in\n"
+            "                                 64 ranges of txids that are combined in order\n"
+            "  \"utxo_commitment\": \"hash\",   (string) The elliptic curve multiset hash of the UTXO set, which is\n"
+            "                                 kept up to date as blocks are connected and disconnected\n"
+            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
+            "  \"total_amount\": x.xxx          (numeric) The total amount\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleCli("gettxoutsetinfo", "true") +
+            HelpExampleRpc("gettxoutsetinfo", ""));
 
     UniValue ret(UniValue::VOBJ);
 
+    if (params.size() > 0 && params[0].get_bool())
+    {
+        CECMultiSet commitment;
+        LOCK(cs_main);
+        const uint256 hashBlock = pcoinsTip->GetBestBlock();
+        CBlockIndex *pindex = LookupBlockIndex(hashBlock);
+        ret.pushKV("height", pindex ? (int64_t)pindex->nHeight : (int64_t)-1);
+        ret.pushKV("bestblock", hashBlock.GetHex());
+        if (pcoinsTip->GetUtxoCommitment(commitment))
+            ret.pushKV("utxo_commitment", commitment.GetHash().GetHex());
+        return ret;
+    }
+
     CCoinsStats stats;
     FlushStateToDisk();
     if (GetUTXOStats(pcoinsdbview, stats))
@@ -962,12 +1112,118 @@ UniValue gettxoutsetinfo(const UniValue &params, bool fHelp)
         ret.pushKV("transactions", (int64_t)stats.nTransactions);
         ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
         ret.pushKV("hash_serialized_2", stats.hashSerialized.GetHex());
+        ret.pushKV("hash_serialized_3", stats.hashSerializedRanges.GetHex());
+        if (stats.fHaveUtxoCommitment)
+            ret.pushKV("utxo_commitment", stats.hashUtxoCommitment.GetHex());
         ret.pushKV("disk_size", stats.nDiskSize);
         ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
     }
     return ret;
 }
 
+UniValue scantxoutset(const UniValue &params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "scantxoutset [\"address\" or \"script\",...]\n"
+            "\nFind the unspent outputs that pay to any of the given addresses or output scripts, by scanning the\n"
+            "whole UTXO set.  The set is split into ranges that are scanned in parallel.\n"
+            "\nArguments:\n"
+            "1. [\"address\" or \"script\",...]  (array, required) Addresses, or output scripts in hex\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"success\": true,           (boolean) Whether the scan was completed\n"
+            "  \"searched_items\": n,       (numeric) The number of unspent outputs scanned\n"
+            "  \"height\": n,               (numeric) The height of the block that the UTXO set is after\n"
+            "  \"bestblock\": \"hash\",     (string) The hash of that block\n"
+            "  \"unspents\": [\n"
+            "    {\n"
+            "      \"txid\": \"hash\",      (string) The transaction id\n"
+            "      \"vout\": n,             (numeric) The output index\n"
+            "      \"scriptPubKey\": \"hex\", (string) The output script\n"
+            "      \"amount\": x.xxx,       (numeric) The amount in " +
+            CURRENCY_UNIT +
+            "\n"
+            "      \"height\": n,           (numeric) The height of the block that created the output\n"
+            "    }\n"
+            "    ,...\n"
+            "  ],\n"
+            "  \"total_amount\": x.xxx      (numeric) The total amount of the unspent outputs found\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("scantxoutset", "\"[\\\"1PUYsjwfNmX64wS368ZR5FMouTtUmvtmTY\\\"]\"") +
+            HelpExampleRpc("scantxoutset", "[\"1PUYsjwfNmX64wS368ZR5FMouTtUmvtmTY\"]"));
+
+    std::set<CScript> scripts;
+    for (const UniValue &item : params[0].get_array().getValues())
+    {
+        const std::string &str = item.get_str();
+        CTxDestination dest = DecodeDestination(str);
+        if (IsValidDestination(dest))
+            scripts.insert(GetScriptForDestination(dest));
+        else if (!str.empty() && IsHex(str))
+        {
+            std::vector<unsigned char> data(ParseHex(str));
+            scripts.insert(CScript(data.begin(), data.end()));
+        }
+        else
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address or script: " + str);
+    }
+
+    std::vector<std::vector<std::pair<COutPoint, Coin> > > rangeFound(UTXO_SCAN_RANGES);
+    std::atomic<uint64_t> nSearched{0};
+    uint256 hashBlock;
+    FlushStateToDisk();
+    bool fOk = pcoinsdbview->ForEachCoinRange(UTXO_SCAN_RANGES,
+        [&scripts, &rangeFound, &nSearched, &hashBlock](CCoinsViewCursor &cursor, unsigned int nRange) {
+            if (nRange == 0)
+                hashBlock = cursor.GetBestBlock();
+            uint64_t nCoins = 0;
+            for (; cursor.Valid(); cursor.Next(), nCoins++)
+            {
+                if (ShutdownRequested())
+                    return false;
+                COutPoint key;
+                Coin coin;
+                if (!cursor.GetKey(key) || !cursor.GetValue(coin))
+                    return error("%s: unable to read value", __func__);
+                if (scripts.count(coin.out.scriptPubKey))
+                    rangeFound[nRange].emplace_back(key, std::move(coin));
+            }
+            nSearched += nCoins;
+            return true;
+        });
+    if (!fOk)
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to scan the UTXO set");
+
+    UniValue unspents(UniValue::VARR);
+    CAmount nTotal = 0;
+    for (const auto &found : rangeFound)
+    {
+        for (const auto &coin : found)
+        {
+            UniValue unspent(UniValue::VOBJ);
+            unspent.pushKV("txid", coin.first.hash.GetHex());
+            unspent.pushKV("vout", (int64_t)coin.first.n);
+            unspent.pushKV("scriptPubKey", HexStr(coin.second.out.scriptPubKey));
+            unspent.pushKV("amount", ValueFromAmount(coin.second.out.nValue));
+            unspent.pushKV("height", (int64_t)coin.second.nHeight);
+            unspents.push_back(unspent);
+            nTotal += coin.second.out.nValue;
+        }
+    }
+
+    CBlockIndex *pindex = LookupBlockIndex(hashBlock);
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("success", true);
+    ret.pushKV("searched_items", nSearched.load());
+    ret.pushKV("height", pindex ? (int64_t)pindex->nHeight : (int64_t)-1);
+    ret.pushKV("bestblock", hashBlock.GetHex());
+    ret.pushKV("unspents", unspents);
+    ret.pushKV("total_amount", ValueFromAmount(nTotal));
+    return ret;
+}
+
 UniValue evicttransaction(const UniValue &params, bool fHelp)
 {
     if (fHelp || params.size() < 1)
@@ -2217,6 +2473,101 @@ UniValue savemempool(const UniValue &params, bool fHelp)
     return NullUniValue;
 }
 
+//! Resolve a snapshot path, which is relative to the data directory unless it is absolute
+static fs::path GetSnapshotPath(const UniValue &param)
+{
+    fs::path path(param.get_str());
+    if (path.empty())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Empty path");
+    return fs::absolute(path, GetDataDir());
+}
+
+UniValue dumputxoset(const UniValue &params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw std::runtime_error(
+            "dumputxoset \"path\"\n"
+            "\nWrite the UTXO set at the current tip to a snapshot file, which loadutxoset or -loadutxoset can load.\n"
+            "Blocks are still connected while the file is written.\n"
+            "\nArguments:\n"
+            "1. \"path\"    (string, required) The file to write, relative to the data directory unless it is absolute\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coins_written\": n,         (numeric) The number of coins in the snapshot\n"
+            "  \"base_hash\": \"hash\",       (string) The block that the snapshot is the UTXO set after\n"
+            "  \"base_height\": n,           (numeric) The height of that block\n"
+            "  \"path\": \"path\",            (string) The absolute path of the snapshot\n"
+            "  \"utxo_commitment\": \"hash\", (string) The UTXO set commitment of the snapshot\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("dumputxoset", "\"utxo.dat\"") + HelpExampleRpc("dumputxoset", "\"utxo.dat\""));
+
+    const fs::path path = GetSnapshotPath(params[0]);
+    if (fs::exists(path))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+
+    CUtxoSnapshotHeader header;
+    std::string strError;
+    if (!DumpUtxoSnapshot(path, header, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    CBlockIndex *pindex = LookupBlockIndex(header.hashBlock);
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("coins_written", header.nCoins);
+    ret.pushKV("base_hash", header.hashBlock.GetHex());
+    ret.pushKV("base_height", pindex ? (int64_t)pindex->nHeight : (int64_t)-1);
+    ret.pushKV("path", path.string());
+    ret.pushKV("utxo_commitment", header.hashCommitment.GetHex());
+    return ret;
+}
+
+UniValue loadutxoset(const UniValue &params, bool fHelp)
+{
+    if (fHelp || params.size() != 2)
+        throw std::runtime_error(
+            "loadutxoset \"path\" \"commitment\"\n"
+            "\nReplace the UTXO set with a snapshot written by dumputxoset, and continue the chain from its block.\n"
+            "The block of the snapshot and its ancestors must already be downloaded, and the current tip must be\n"
+            "one of its ancestors.  The blocks up to the snapshot are not connected, so they can not be\n"
+            "disconnected again.  The coins are checked against the expected commitment before any of them is\n"
+            "written.\n"
+            "\nArguments:\n"
+            "1. \"path\"       (string, required) The snapshot, relative to the data directory unless it is absolute\n"
+            "2. \"commitment\" (string, required) The UTXO set commitment that the snapshot must have, as returned\n"
+            "                by dumputxoset or gettxoutsetinfo on a node that is trusted\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coins_loaded\": n,          (numeric) The number of coins in the snapshot\n"
+            "  \"base_hash\": \"hash\",       (string) The block that the snapshot is the UTXO set after\n"
+            "  \"base_height\": n,           (numeric) The height of that block\n"
+            "  \"utxo_commitment\": \"hash\", (string) The UTXO set commitment of the snapshot\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("loadutxoset", "\"utxo.dat\" \"commitment\"") +
+            HelpExampleRpc("loadutxoset", "\"utxo.dat\", \"commitment\""));
+
+    const fs::path path = GetSnapshotPath(params[0]);
+    const uint256 hashExpected = ParseHashV(params[1], "commitment");
+
+    CUtxoSnapshotHeader header;
+    std::string strError;
+    if (!LoadUtxoSnapshot(path, hashExpected, header, strError))
+        throw JSONRPCError(RPC_DATABASE_ERROR, strError);
+
+    CValidationState state;
+    ActivateBestChain(state, Params());
+    if (!state.IsValid())
+        throw JSONRPCError(RPC_DATABASE_ERROR, state.GetRejectReason());
+
+    CBlockIndex *pindex = LookupBlockIndex(header.hashBlock);
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("coins_loaded", header.nCoins);
+    ret.pushKV("base_hash", header.hashBlock.GetHex());
+    ret.pushKV("base_height", pindex ? (int64_t)pindex->nHeight : (int64_t)-1);
+    ret.pushKV("utxo_commitment", header.hashCommitment.GetHex());
+    return ret;
+}
+
 UniValue saveorphanpool(const UniValue &params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -2343,9 +2694,11 @@ static const CRPCCommand commands[] = {
     {"blockchain", "getorphanpoolinfo", &getorphanpoolinfo, true},
     {"blockchain", "evicttransaction", &evicttransaction, true}, {"blockchain", "getrawmempool", &getrawmempool, true},
     {"blockchain", "getraworphanpool", &getraworphanpool, true}, {"blockchain", "gettxout", &gettxout, true},
-    {"blockchain", "gettxoutsetinfo", &gettxoutsetinfo, true}, {"blockchain", "savemempool", &savemempool, true},
+    {"blockchain", "gettxoutsetinfo", &gettxoutsetinfo, true}, {"blockchain", "scantxoutset", &scantxoutset, true},
+    {"blockchain", "savemempool", &savemempool, true},
     {"blockchain", "saveorphanpool", &saveorphanpool, true}, {"blockchain", "verifychain", &verifychain, true},
-    {"blockchain", "getblockstats", &getblockstats, true},
+    {"blockchain", "getblockstats", &getblockstats, true}, {"blockchain", "dumputxoset", &dumputxoset, true},
+    {"blockchain", "loadutxoset", &loadutxoset, false},
 
     /* Not shown in help */
     {"hidden", "invalidateblock", &invalidateblock, true}, {"hidden", "reconsiderblock", &reconsiderblock, true},
@@ -132,6 +132,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     {"sendrawtransaction", 1},
     {"validaterawtransaction", 1},
     {"fundrawtransaction", 1},
+    {"gettxoutsetinfo", 0}, {"scantxoutset", 0},
     {"gettxout", 1},
     {"gettxout", 2},
     {"gettxoutproof", 0},
@@ -1851,7 +1851,7 @@ bool TransactionSignatureChecker::CheckSig(const vector<unsigned char> &vchSigIn
     if (nFlags & SCRIPT_ENABLE_SIGHASH_FORKID)
     {
         if (nHashType & SIGHASH_FORKID)
-            sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, &nHashed);
+            sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, &nHashed, txdata);
         else
             return false;
     }
@@ -151,13 +151,28 @@ bool CheckDataSignatureEncoding(const std::vector<uint8_t> &vchSig, uint32_t fla
 // problems during signature hash calculations for any current BCH signature hash functions!
 extern const uint256 SIGNATURE_HASH_ERROR;
 
+/**
+ * The parts of the BitcoinCash signature hash that only depend on the transaction, not on the input being
+ * signed.  Computing them once per transaction and sharing them between the checks of every input keeps
+ * signature hashing linear in the size of the transaction rather than quadratic.
+ */
+struct PrecomputedTransactionData
+{
+    uint256 hashPrevouts;
+    uint256 hashSequence;
+    uint256 hashOutputs;
+
+    explicit PrecomputedTransactionData(const CTransaction &tx);
+};
+
 // If you are signing you may call this function and the BitcoinCash or Legacy method will be chosen based on nHashType
 uint256 SignatureHash(const CScript &scriptCode,
     const CTransaction &txTo,
     unsigned int nIn,
     uint32_t nHashType,
     const CAmount &amount,
-    size_t *nHashedOut = nullptr);
+    size_t *nHashedOut = nullptr,
+    const PrecomputedTransactionData *cache = nullptr);
 
 class BaseSignatureChecker
 {
@@ -189,6 +204,7 @@ protected:
     const CTransaction *txTo;
     unsigned int nIn;
     const CAmount amount;
+    const PrecomputedTransactionData *txdata;
     mutable size_t nBytesHashed;
     mutable size_t nSigops;
 
@@ -196,8 +212,9 @@ public:
     TransactionSignatureChecker(const CTransaction *txToIn,
         unsigned int nInIn,
         const CAmount &amountIn,
-        unsigned int flags = SCRIPT_ENABLE_SIGHASH_FORKID)
-        : txTo(txToIn), nIn(nInIn), amount(amountIn), nBytesHashed(0), nSigops(0)
+        unsigned int flags = SCRIPT_ENABLE_SIGHASH_FORKID,
+        const PrecomputedTransactionData *txdataIn = nullptr)
+        : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(txdataIn), nBytesHashed(0), nSigops(0)
     {
         nFlags = flags;
     }
@@ -166,10 +166,41 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsig
 }
 #endif
 
+bool CSignatureBatch::Add(const CPubKey &pubkey,
+    const uint256 &sighash,
+    const std::vector<uint8_t> &vchSig,
+    const uint256 *entry)
+{
+    if (!sigs.Add(pubkey, sighash, vchSig))
+        return false;
+    if (entry)
+        vCacheEntries.push_back(*entry);
+    return true;
+}
+
+bool CSignatureBatch::Verify()
+{
+    if (!sigs.Verify())
+        return false;
+    for (uint256 &entry : vCacheEntries)
+        signatureCache.Set(entry);
+    return true;
+}
+
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<uint8_t> &vchSig,
     const CPubKey &pubkey,
     const uint256 &sighash) const
 {
+    // With NULLFAIL an invalid non-empty signature fails the script no matter how its result is used, so a
+    // Schnorr signature can be reported as valid now and verified later together with the rest of the batch.
+    if (batch && vchSig.size() == 64 && (nFlags & SCRIPT_VERIFY_NULLFAIL))
+    {
+        uint256 entry;
+        signatureCache.ComputeEntry(entry, vchSig, pubkey, sighash, nFlags);
+        if (signatureCache.Get(entry, !store))
+            return true;
+        return batch->Add(pubkey, sighash, vchSig, store ? &entry : nullptr);
+    }
     return RunMemoizedCheck(vchSig, pubkey, sighash, nFlags, store,
         [&] { return TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash); });
 }
@@ -7,6 +7,7 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include "pubkey.h"
 #include "script/interpreter.h"
 
 #include <vector>
@@ -39,18 +40,50 @@ public:
     }
 };
 
+/**
+ * Schnorr signatures whose verification has been deferred by CachingTransactionSignatureChecker so that they
+ * can be verified together.  They are only added to the signature cache once the whole batch is verified.
+ */
+class CSignatureBatch
+{
+private:
+    CSchnorrBatch sigs;
+    //! Signature cache entries to store if the batch is valid
+    std::vector<uint256> vCacheEntries;
+
+public:
+    bool Add(const CPubKey &pubkey, const uint256 &sighash, const std::vector<uint8_t> &vchSig, const uint256 *entry);
+    bool Verify();
+    //! Verify only the n-th signature, in the order they were added, without caching it
+    bool VerifyOne(size_t n) const { return sigs.VerifyOne(n); }
+    size_t size() const { return sigs.size(); }
+    bool empty() const { return sigs.empty(); }
+    void clear()
+    {
+        sigs.clear();
+        vCacheEntries.clear();
+    }
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
     bool store;
+    CSignatureBatch *batch;
 
 public:
+    /**
+     * If a batch is given, Schnorr signatures are not verified right away but added to the batch, and
+     * reported as valid.  The caller must verify the batch before relying on the result of the script.
+     */
     CachingTransactionSignatureChecker(const CTransaction *txToIn,
         unsigned int nInIn,
         const CAmount &amountIn,
         unsigned int flags,
-        bool storeIn = true)
-        : TransactionSignatureChecker(txToIn, nInIn, amountIn, flags), store(storeIn)
+        bool storeIn = true,
+        const PrecomputedTransactionData *txdataIn = nullptr,
+        CSignatureBatch *batchIn = nullptr)
+        : TransactionSignatureChecker(txToIn, nInIn, amountIn, flags, txdataIn), store(storeIn), batch(batchIn)
     {
     }
 
@@ -209,13 +209,21 @@ uint256 SignatureHashLegacy(const CScript &scriptCode,
     return ss.GetHash();
 }
 
+PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction &txTo)
+{
+    hashPrevouts = GetPrevoutHash(txTo);
+    hashSequence = GetSequenceHash(txTo);
+    hashOutputs = GetOutputsHash(txTo);
+}
+
 // ONLY to be called with SIGHASH_FORKID set in nHashType!
 static uint256 SignatureHashBitcoinCash(const CScript &scriptCode,
     const CTransaction &txTo,
     unsigned int nIn,
     uint32_t nHashType,
     const CAmount &amount,
-    size_t *nHashedOut)
+    size_t *nHashedOut,
+    const PrecomputedTransactionData *cache)
 {
     uint256 hashPrevouts;
     uint256 hashSequence;
@@ -223,18 +231,18 @@ static uint256 SignatureHashBitcoinCash(const CScript &scriptCode,
 
     if (!(nHashType & SIGHASH_ANYONECANPAY))
     {
-        hashPrevouts = GetPrevoutHash(txTo);
+        hashPrevouts = cache ? cache->hashPrevouts : GetPrevoutHash(txTo);
     }
 
     if (!(nHashType & SIGHASH_ANYONECANPAY) && (nHashType & 0x1f) != SIGHASH_SINGLE &&
         (nHashType & 0x1f) != SIGHASH_NONE)
     {
-        hashSequence = GetSequenceHash(txTo);
+        hashSequence = cache ? cache->hashSequence : GetSequenceHash(txTo);
     }
 
     if ((nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE)
     {
-        hashOutputs = GetOutputsHash(txTo);
+        hashOutputs = cache ? cache->hashOutputs : GetOutputsHash(txTo);
     }
     else if ((nHashType & 0x1f) == SIGHASH_SINGLE && nIn < txTo.vout.size())
     {
@@ -274,11 +282,12 @@ uint256 SignatureHash(const CScript &scriptCode,
     unsigned int nIn,
     uint32_t nHashType,
     const CAmount &amount,
-    size_t *nHashedOut)
+    size_t *nHashedOut,
+    const PrecomputedTransactionData *cache)
 {
     if (nHashType & SIGHASH_FORKID)
     {
-        return SignatureHashBitcoinCash(scriptCode, txTo, nIn, nHashType, amount, nHashedOut);
+        return SignatureHashBitcoinCash(scriptCode, txTo, nIn, nHashType, amount, nHashedOut, cache);
     }
     return SignatureHashLegacy(scriptCode, txTo, nIn, nHashType, amount, nHashedOut);
 }
@@ -23,6 +23,33 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorr_verify(
   const secp256k1_pubkey *pubkey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/**
+ * Verify a batch of signatures created by secp256k1_schnorr_sign.
+ * All signatures are checked together with a single multi-multiplication,
+ * which is considerably faster than verifying them one by one. The batch is
+ * weighted with coefficients derived from a hash of all the inputs, so a
+ * batch containing an invalid signature is rejected (except with negligible
+ * probability). A failed batch does not say which signature is invalid; use
+ * secp256k1_schnorr_verify to find out.
+ * Returns: 1: all signatures are correct (or n_sigs is 0)
+ *          0: at least one signature is incorrect
+ * Args:    ctx:       a secp256k1 context object, initialized for verification.
+ *          scratch:   scratch space used for the multi-multiplication. If
+ *                     NULL the signatures are effectively checked one by one.
+ * In:      sig64:     array of n_sigs pointers to 64-byte signatures
+ *          msg32:     array of n_sigs pointers to 32-byte message hashes
+ *          pubkeys:   array of n_sigs pointers to public keys
+ *          n_sigs:    the number of signatures
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorr_verify_batch(
+  const secp256k1_context* ctx,
+  secp256k1_scratch_space *scratch,
+  const unsigned char *const *sig64,
+  const unsigned char *const *msg32,
+  const secp256k1_pubkey *const *pubkeys,
+  size_t n_sigs
+) SECP256K1_ARG_NONNULL(1);
+
 /**
  * Create a signature using a custom EC-Schnorr-SHA256 construction. It
  * produces non-malleable 64-byte signatures which support batch validation,
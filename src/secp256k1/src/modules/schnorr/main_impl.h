@@ -27,6 +27,125 @@ int secp256k1_schnorr_verify(
     return secp256k1_schnorr_sig_verify(&ctx->ecmult_ctx, sig64, &q, msg32);
 }
 
+/* Number of signatures combined into one multi-multiplication */
+#define SECP256K1_SCHNORR_BATCH_CHUNK 64
+
+typedef struct {
+    secp256k1_scalar sc[2 * SECP256K1_SCHNORR_BATCH_CHUNK];
+    secp256k1_ge pt[2 * SECP256K1_SCHNORR_BATCH_CHUNK];
+} secp256k1_schnorr_batch_data;
+
+static int secp256k1_schnorr_batch_callback(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *data) {
+    secp256k1_schnorr_batch_data *batch = (secp256k1_schnorr_batch_data *)data;
+    *sc = batch->sc[idx];
+    *pt = batch->pt[idx];
+    return 1;
+}
+
+/**
+ * For signatures (r_i, s_i) on messages m_i with public keys P_i, check that
+ *   sum(a_i * R_i) + sum(a_i * e_i * P_i) - sum(a_i * s_i) * G == 0
+ * where R_i is the point with x coordinate r_i and a quadratic residue y
+ * coordinate (see Option 2 in schnorr_impl.h). The coefficients a_i are
+ * derived from a hash of the whole batch, with a_0 = 1 in every chunk.
+ */
+int secp256k1_schnorr_verify_batch(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space *scratch,
+    const unsigned char *const *sig64,
+    const unsigned char *const *msg32,
+    const secp256k1_pubkey *const *pubkeys,
+    size_t n_sigs
+) {
+    secp256k1_schnorr_batch_data batch;
+    secp256k1_sha256 sha;
+    unsigned char seed[32];
+    size_t i, start;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    if (n_sigs == 0) {
+        return 1;
+    }
+    ARG_CHECK(sig64 != NULL);
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(pubkeys != NULL);
+
+    secp256k1_sha256_initialize(&sha);
+    for (i = 0; i < n_sigs; i++) {
+        secp256k1_sha256_write(&sha, sig64[i], 64);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+        secp256k1_sha256_write(&sha, pubkeys[i]->data, sizeof(pubkeys[i]->data));
+    }
+    secp256k1_sha256_finalize(&sha, seed);
+
+    for (start = 0; start < n_sigs; start += SECP256K1_SCHNORR_BATCH_CHUNK) {
+        size_t n = n_sigs - start;
+        secp256k1_scalar s_sum;
+        secp256k1_gej rj;
+        if (n > SECP256K1_SCHNORR_BATCH_CHUNK) {
+            n = SECP256K1_SCHNORR_BATCH_CHUNK;
+        }
+
+        secp256k1_scalar_set_int(&s_sum, 0);
+        for (i = 0; i < n; i++) {
+            const unsigned char *sig = sig64[start + i];
+            secp256k1_scalar a, e, s;
+            secp256k1_fe rx;
+            int overflow = 0;
+
+            secp256k1_pubkey_load(ctx, &batch.pt[2 * i + 1], pubkeys[start + i]);
+            if (secp256k1_ge_is_infinity(&batch.pt[2 * i + 1])) {
+                return 0;
+            }
+
+            secp256k1_scalar_set_b32(&s, sig + 32, &overflow);
+            if (overflow) {
+                return 0;
+            }
+            if (!secp256k1_fe_set_b32(&rx, sig)) {
+                return 0;
+            }
+            if (!secp256k1_ge_set_xquad(&batch.pt[2 * i], &rx)) {
+                return 0;
+            }
+            secp256k1_schnorr_compute_e(&e, sig, &batch.pt[2 * i + 1], msg32[start + i]);
+
+            if (i == 0) {
+                secp256k1_scalar_set_int(&a, 1);
+            } else {
+                unsigned char buf[32];
+                unsigned char idx[8];
+                uint64_t pos = start + i;
+                int j;
+                for (j = 0; j < 8; j++) {
+                    idx[j] = (unsigned char)(pos >> (8 * j));
+                }
+                secp256k1_sha256_initialize(&sha);
+                secp256k1_sha256_write(&sha, seed, 32);
+                secp256k1_sha256_write(&sha, idx, 8);
+                secp256k1_sha256_finalize(&sha, buf);
+                secp256k1_scalar_set_b32(&a, buf, NULL);
+            }
+
+            batch.sc[2 * i] = a;
+            secp256k1_scalar_mul(&batch.sc[2 * i + 1], &a, &e);
+            secp256k1_scalar_mul(&s, &s, &a);
+            secp256k1_scalar_add(&s_sum, &s_sum, &s);
+        }
+
+        secp256k1_scalar_negate(&s_sum, &s_sum);
+        if (!secp256k1_ecmult_multi_var(&ctx->error_callback, &ctx->ecmult_ctx, scratch, &rj, &s_sum,
+                secp256k1_schnorr_batch_callback, &batch, 2 * n)) {
+            return 0;
+        }
+        if (!secp256k1_gej_is_infinity(&rj)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 int secp256k1_schnorr_sign(
     const secp256k1_context *ctx,
     unsigned char *sig64,
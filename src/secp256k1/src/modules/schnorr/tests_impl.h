@@ -78,6 +78,62 @@ void test_schnorr_sign_verify(void) {
 
 #undef SIG_COUNT
 
+#define BATCH_COUNT 100
+
+void test_schnorr_verify_batch(void) {
+    unsigned char privkey[BATCH_COUNT][32];
+    unsigned char msg[BATCH_COUNT][32];
+    unsigned char sig[BATCH_COUNT][64];
+    secp256k1_pubkey pubkey[BATCH_COUNT];
+    const unsigned char *sigptr[BATCH_COUNT];
+    const unsigned char *msgptr[BATCH_COUNT];
+    const secp256k1_pubkey *pubkeyptr[BATCH_COUNT];
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, 1024 * 1024);
+    int i;
+
+    for (i = 0; i < BATCH_COUNT; i++) {
+        secp256k1_scalar key;
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(privkey[i], &key);
+        secp256k1_rand256_test(msg[i]);
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pubkey[i], privkey[i]) == 1);
+        CHECK(secp256k1_schnorr_sign(ctx, sig[i], msg[i], privkey[i], NULL, NULL) == 1);
+        sigptr[i] = sig[i];
+        msgptr[i] = msg[i];
+        pubkeyptr[i] = &pubkey[i];
+    }
+
+    /* An empty batch is valid */
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, NULL, NULL, NULL, 0) == 1);
+    /* Batches spanning several chunks, with and without scratch space */
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 1);
+    CHECK(secp256k1_schnorr_verify_batch(ctx, NULL, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 1);
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, 1) == 1);
+
+    /* Any one bad signature, message or key fails the whole batch */
+    for (i = 0; i < count; i++) {
+        int n = secp256k1_rand_int(BATCH_COUNT);
+        int pos = secp256k1_rand_bits(6);
+        int mod = 1 + secp256k1_rand_int(255);
+        sig[n][pos] ^= mod;
+        CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 0);
+        sig[n][pos] ^= mod;
+
+        msg[n][pos & 31] ^= mod;
+        CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 0);
+        msg[n][pos & 31] ^= mod;
+
+        pubkeyptr[n] = &pubkey[(n + 1) % BATCH_COUNT];
+        CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 0);
+        pubkeyptr[n] = &pubkey[n];
+    }
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, BATCH_COUNT) == 1);
+
+    secp256k1_scratch_space_destroy(ctx, scratch);
+}
+
+#undef BATCH_COUNT
+
 void run_schnorr_compact_test(void) {
     {
         /* Test vector 1 */
@@ -516,6 +572,7 @@ void run_schnorr_tests(void) {
     }
 
     test_schnorr_sign_verify();
+    test_schnorr_verify_batch();
     run_schnorr_compact_test();
 }
 
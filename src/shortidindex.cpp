@@ -0,0 +1,233 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "shortidindex.h"
+
+#include "hashwrapper.h"
+#include "utiltime.h"
+#include "workerpool.h"
+
+#include <algorithm>
+
+//! Batches of short ids are only split into tasks if each task gets at least this many
+static const size_t MIN_SHORTIDS_PER_TASK = 16384;
+
+uint64_t CShortIdSalt::GetShortID(const uint256 &txid) const
+{
+    if (nMask == 0)
+        return txid.GetCheapHash();
+    return SipHashUint256(k0, k1, txid) & nMask;
+}
+
+void CShortIdSalt::GetShortIDs(const uint256 *pTxids, size_t nCount, uint64_t *pShortIds) const
+{
+    if (nMask == 0)
+    {
+        for (size_t i = 0; i < nCount; i++)
+            pShortIds[i] = pTxids[i].GetCheapHash();
+        return;
+    }
+
+    auto hashRange = [this, pTxids, pShortIds](size_t nBegin, size_t nEnd) {
+        SipHashUint256Batch(k0, k1, pTxids + nBegin, pShortIds + nBegin, nEnd - nBegin);
+        for (size_t i = nBegin; i < nEnd; i++)
+            pShortIds[i] &= nMask;
+    };
+
+    CWorkerPool &pool = GetWorkerPool();
+    const size_t nTasks = std::min(pool.Concurrency(), nCount / MIN_SHORTIDS_PER_TASK);
+    if (nTasks <= 1)
+    {
+        hashRange(0, nCount);
+        return;
+    }
+
+    const size_t nPerTask = (nCount + nTasks - 1) / nTasks;
+    pool.ForEach(nTasks, [&hashRange, nPerTask, nCount](size_t n) {
+        hashRange(std::min(nCount, n * nPerTask), std::min(nCount, (n + 1) * nPerTask));
+    });
+}
+
+std::vector<uint64_t> CShortIdSalt::GetShortIDs(const std::vector<uint256> &vTxids) const
+{
+    std::vector<uint64_t> vShortIds(vTxids.size());
+    GetShortIDs(vTxids.data(), vTxids.size(), vShortIds.data());
+    return vShortIds;
+}
+
+void CShortIdIndex::SaltMap::Add(const uint256 &txid, uint64_t nShortId)
+{
+    auto ret = mapTxids.emplace(nShortId, txid);
+    if (!ret.second && ret.first->second != txid)
+        mapCollisions.emplace(nShortId, txid);
+}
+
+void CShortIdIndex::SaltMap::Remove(const uint256 &txid)
+{
+    const uint64_t nShortId = salt.GetShortID(txid);
+    auto it = mapTxids.find(nShortId);
+    if (it == mapTxids.end())
+        return;
+    auto range = mapCollisions.equal_range(nShortId);
+    if (it->second == txid)
+    {
+        // Let one of the transactions with the same short id take its place
+        if (range.first == range.second)
+            mapTxids.erase(it);
+        else
+        {
+            it->second = range.first->second;
+            mapCollisions.erase(range.first);
+        }
+        return;
+    }
+    for (auto iter = range.first; iter != range.second; ++iter)
+    {
+        if (iter->second == txid)
+        {
+            mapCollisions.erase(iter);
+            return;
+        }
+    }
+}
+
+void CShortIdIndex::Add(const uint256 &txid)
+{
+    LOCK(cs_shortids);
+    if (pCheapHashMap)
+        pCheapHashMap->Add(txid);
+    for (auto &pSaltMap : vSaltMaps)
+        pSaltMap->Add(txid);
+}
+
+void CShortIdIndex::Remove(const uint256 &txid)
+{
+    LOCK(cs_shortids);
+    if (pCheapHashMap)
+        pCheapHashMap->Remove(txid);
+    for (auto &pSaltMap : vSaltMaps)
+        pSaltMap->Remove(txid);
+}
+
+void CShortIdIndex::Clear()
+{
+    LOCK(cs_shortids);
+    // The pool is empty now, so an empty map still matches it
+    if (pCheapHashMap)
+    {
+        pCheapHashMap->mapTxids.clear();
+        pCheapHashMap->mapCollisions.clear();
+    }
+    vSaltMaps.clear();
+}
+
+void CShortIdIndex::Release(const CShortIdSalt &salt)
+{
+    LOCK(cs_shortids);
+    vSaltMaps.erase(std::remove_if(vSaltMaps.begin(), vSaltMaps.end(),
+                        [&salt](const std::unique_ptr<SaltMap> &pSaltMap) { return pSaltMap->salt == salt; }),
+        vSaltMaps.end());
+}
+
+bool CShortIdIndex::IsCheapHashIndexed() const
+{
+    LOCK(cs_shortids);
+    return pCheapHashMap != nullptr;
+}
+
+size_t CShortIdIndex::NumSalts() const
+{
+    LOCK(cs_shortids);
+    return vSaltMaps.size();
+}
+
+CShortIdIndex::SaltMap &CShortIdIndex::GetSaltMap(const CShortIdSalt &salt, const TxidsFn &fnTxids)
+{
+    AssertLockHeld(cs_shortids);
+    SaltMap *pFound = nullptr;
+    if (salt.nMask == 0)
+        pFound = pCheapHashMap.get();
+    else
+    {
+        const int64_t nNow = GetTime();
+        for (auto it = vSaltMaps.begin(); it != vSaltMaps.end();)
+        {
+            if ((*it)->salt == salt)
+                pFound = it->get();
+            else if ((*it)->nLastUsed + SALT_EXPIRY < nNow)
+            {
+                // Keeping the map up to date costs time on every change to the pool, and it takes memory
+                it = vSaltMaps.erase(it);
+                continue;
+            }
+            ++it;
+        }
+        if (pFound != nullptr)
+            pFound->nLastUsed = nNow;
+    }
+    if (pFound != nullptr)
+        return *pFound;
+
+    std::unique_ptr<SaltMap> pSaltMap(new SaltMap());
+    pSaltMap->salt = salt;
+    pSaltMap->nLastUsed = GetTime();
+    std::vector<uint256> vTxids;
+    fnTxids(vTxids);
+    std::vector<uint64_t> vShortIds = salt.GetShortIDs(vTxids);
+    for (size_t i = 0; i < vTxids.size(); i++)
+        pSaltMap->Add(vTxids[i], vShortIds[i]);
+    pFound = pSaltMap.get();
+    if (salt.nMask == 0)
+        pCheapHashMap = std::move(pSaltMap);
+    else
+    {
+        if (vSaltMaps.size() >= MAX_SALTS)
+        {
+            auto itOldest = std::min_element(vSaltMaps.begin(), vSaltMaps.end(),
+                [](const std::unique_ptr<SaltMap> &a, const std::unique_ptr<SaltMap> &b) {
+                    return a->nLastUsed < b->nLastUsed;
+                });
+            vSaltMaps.erase(itOldest);
+        }
+        vSaltMaps.push_back(std::move(pSaltMap));
+    }
+    return *pFound;
+}
+
+size_t CShortIdIndex::Find(const CShortIdSalt &salt,
+    const std::vector<uint64_t> &vShortIds,
+    std::vector<uint256> &vTxids,
+    const TxidsFn &fnTxids)
+{
+    LOCK(cs_shortids);
+    const SaltMap &saltMap = GetSaltMap(salt, fnTxids);
+
+    size_t nCollisions = 0;
+    vTxids.assign(vShortIds.size(), uint256());
+    for (size_t i = 0; i < vShortIds.size(); i++)
+    {
+        auto it = saltMap.mapTxids.find(vShortIds[i]);
+        if (it == saltMap.mapTxids.end())
+            continue;
+        vTxids[i] = it->second;
+        if (!saltMap.mapCollisions.empty() && saltMap.mapCollisions.count(vShortIds[i]))
+            nCollisions++;
+    }
+    return nCollisions;
+}
+
+void CShortIdIndex::GetAll(const CShortIdSalt &salt,
+    std::vector<std::pair<uint64_t, uint256> > &vAll,
+    const TxidsFn &fnTxids)
+{
+    LOCK(cs_shortids);
+    const SaltMap &saltMap = GetSaltMap(salt, fnTxids);
+
+    vAll.clear();
+    vAll.reserve(saltMap.mapTxids.size() + saltMap.mapCollisions.size());
+    for (const auto &item : saltMap.mapTxids)
+        vAll.emplace_back(item.first, item.second);
+    for (const auto &item : saltMap.mapCollisions)
+        vAll.emplace_back(item.first, item.second);
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SHORTIDINDEX_H
+#define BITCOIN_SHORTIDINDEX_H
+
+#include "flatmap.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/**
+ * How the short ids of transactions are made from their txids: either the cheap hash of the txid (xthin and old
+ * graphene versions), or a salted SipHash of the txid cut to the bits in nMask (compact blocks and graphene).
+ */
+class CShortIdSalt
+{
+public:
+    uint64_t k0 = 0;
+    uint64_t k1 = 0;
+    //! The bits of the SipHash that make the short id, or 0 to use the cheap hash
+    uint64_t nMask = 0;
+
+    //! Short ids that are cheap hashes
+    CShortIdSalt() {}
+    CShortIdSalt(uint64_t k0In, uint64_t k1In, uint64_t nMaskIn) : k0(k0In), k1(k1In), nMask(nMaskIn) {}
+    uint64_t GetShortID(const uint256 &txid) const;
+
+    /**
+     * The short ids of nCount txids at once, which is much faster than one at a time: SipHashes are computed
+     * several at a time (see SipHashUint256Batch), and large batches are split over the shared worker pool.
+     */
+    void GetShortIDs(const uint256 *pTxids, size_t nCount, uint64_t *pShortIds) const;
+    std::vector<uint64_t> GetShortIDs(const std::vector<uint256> &vTxids) const;
+
+    bool operator==(const CShortIdSalt &other) const
+    {
+        return k0 == other.k0 && k1 == other.k1 && nMask == other.nMask;
+    }
+};
+
+/**
+ * An index from short ids to the txids of the transactions in a pool, so that the transactions of a block
+ * announced by short ids are found in time proportional to the size of the block rather than the size of the pool.
+ *
+ * The map of a salt is built from all the transactions in the pool the first time the salt is looked up, and is
+ * then kept up to date as transactions are added to and removed from the pool.  The cheap hash short ids are the
+ * same for every block and every peer, so their map is kept for as long as the pool exists.  Salted short ids
+ * (compact blocks and graphene) are chosen anew for every block, but are looked up again by the re-requests and
+ * recovery rounds of that block, so the maps of the last few salts are kept until their block is done with
+ * (see Release), or until they have not been used for a while.
+ *
+ * The pool that owns the index calls Add, Remove and Clear while it holds its own lock for writing, and looks up
+ * short ids while it holds its own lock for reading, so that the index always matches the pool.  The index has a
+ * lock of its own because any number of readers may look up short ids at the same time.
+ */
+class CShortIdIndex
+{
+public:
+    enum
+    {
+        //! The most salted short id maps that are kept at the same time
+        MAX_SALTS = 3,
+        //! Drop the map of a salt that has not been used for this many seconds, in case it is never released
+        SALT_EXPIRY = 2 * 60,
+    };
+
+    //! Gives the txids of all the transactions in the pool, for building the map of a salt
+    typedef std::function<void(std::vector<uint256> &)> TxidsFn;
+
+    void Add(const uint256 &txid);
+    void Remove(const uint256 &txid);
+    void Clear();
+
+    //! Drop the map of salt, once the block that uses it has been reconstructed or given up on
+    void Release(const CShortIdSalt &salt);
+
+    /**
+     * Look up the transactions with the short ids vShortIds.  vTxids is set to the txid of the transaction with
+     * each short id, or a null hash if there is none.  Returns the number of the short ids that more than one
+     * transaction has; each of them is given one of its transactions.
+     */
+    size_t Find(const CShortIdSalt &salt,
+        const std::vector<uint64_t> &vShortIds,
+        std::vector<uint256> &vTxids,
+        const TxidsFn &fnTxids);
+
+    //! Get the short id and txid of every transaction in the pool
+    void GetAll(const CShortIdSalt &salt, std::vector<std::pair<uint64_t, uint256> > &vAll, const TxidsFn &fnTxids);
+
+    //! Whether the map of cheap hash short ids has been built
+    bool IsCheapHashIndexed() const;
+    //! The number of salted short id maps that are kept
+    size_t NumSalts() const;
+
+private:
+    struct SaltMap
+    {
+        CShortIdSalt salt;
+        //! One transaction for each short id
+        flatmap<uint64_t, uint256> mapTxids;
+        //! Any other transactions that have the same short id as one in mapTxids
+        std::multimap<uint64_t, uint256> mapCollisions;
+        int64_t nLastUsed = 0;
+
+        void Add(const uint256 &txid, uint64_t nShortId);
+        void Add(const uint256 &txid) { Add(txid, salt.GetShortID(txid)); }
+        void Remove(const uint256 &txid);
+    };
+
+    mutable CCriticalSection cs_shortids;
+    //! The map of cheap hash short ids, which is never dropped
+    std::unique_ptr<SaltMap> pCheapHashMap GUARDED_BY(cs_shortids);
+    //! The maps of salted short ids, at most MAX_SALTS of them
+    std::vector<std::unique_ptr<SaltMap> > vSaltMaps GUARDED_BY(cs_shortids);
+
+    //! The map of salt, which is built if it does not exist yet
+    SaltMap &GetSaltMap(const CShortIdSalt &salt, const TxidsFn &fnTxids) EXCLUSIVE_LOCKS_REQUIRED(cs_shortids);
+};
+
+#endif // BITCOIN_SHORTIDINDEX_H
@@ -0,0 +1,228 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/bitcoin-config.h"
+#endif
+
+#include "socketevents.h"
+
+#include "utiltime.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+//! The most events that one epoll_wait returns.  Any others are reported by the next wait.
+static const int MAX_EPOLL_EVENTS = 1024;
+
+CSocketEvents::CSocketEvents(bool fUseSelect) : hEpoll(-1), nWait(0)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (!fUseSelect)
+        hEpoll = epoll_create1(EPOLL_CLOEXEC);
+#endif
+}
+
+CSocketEvents::~CSocketEvents()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (hEpoll != -1)
+        close(hEpoll);
+#endif
+}
+
+bool CSocketEvents::IsEpollAvailable()
+{
+    static const bool fAvailable = CSocketEvents().UsesEpoll();
+    return fAvailable;
+}
+
+bool CSocketEvents::CanWaitOn(SOCKET hSocket)
+{
+    if (hSocket == INVALID_SOCKET)
+        return false;
+    return IsEpollAvailable() || IsSelectableSocket(hSocket);
+}
+
+void CSocketEvents::Add(SOCKET hSocket, int nEvents, int64_t nOwner)
+{
+    SocketState &state = mapSockets[hSocket];
+    if (state.nOwner != nOwner)
+    {
+        // A new socket with the number of one that was closed, which also closing removed from the epoll set
+        state.nOwner = nOwner;
+        state.nRegistered = -1;
+    }
+    state.nWanted = nEvents & (RECV | SEND);
+    state.nWait = nWait;
+}
+
+int CSocketEvents::Ready(SOCKET hSocket) const
+{
+    auto it = mapSockets.find(hSocket);
+    if (it == mapSockets.end())
+        return 0;
+    return it->second.nReady;
+}
+
+int CSocketEvents::Wait(int64_t nTimeoutMs)
+{
+    int nRet = UsesEpoll() ? WaitEpoll(nTimeoutMs) : WaitSelect(nTimeoutMs);
+    if (nRet == SOCKET_ERROR)
+    {
+        for (auto &item : mapSockets)
+            item.second.nReady = RECV;
+    }
+    nWait++;
+    return nRet;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static uint32_t ToEpollEvents(int nEvents)
+{
+    uint32_t events = 0;
+    if (nEvents & CSocketEvents::RECV)
+        events |= EPOLLIN;
+    if (nEvents & CSocketEvents::SEND)
+        events |= EPOLLOUT;
+    return events;
+}
+
+static int FromEpollEvents(uint32_t events)
+{
+    return ((events & EPOLLIN) ? CSocketEvents::RECV : 0) | ((events & EPOLLOUT) ? CSocketEvents::SEND : 0) |
+           ((events & (EPOLLERR | EPOLLHUP)) ? CSocketEvents::ERR : 0);
+}
+#endif
+
+int CSocketEvents::WaitEpoll(int64_t nTimeoutMs)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    int nReady = 0;
+    for (auto it = mapSockets.begin(); it != mapSockets.end();)
+    {
+        SocketState &state = it->second;
+        state.nReady = 0;
+        if (state.nWait != nWait)
+        {
+            // Not wanted anymore.  The socket may already be closed, which removed it from the epoll set.
+            if (state.nRegistered != -1)
+                epoll_ctl(hEpoll, EPOLL_CTL_DEL, it->first, nullptr);
+            it = mapSockets.erase(it);
+            continue;
+        }
+        if (state.nRegistered != state.nWanted)
+        {
+            struct epoll_event event = {};
+            event.events = ToEpollEvents(state.nWanted);
+            event.data.fd = it->first;
+            // A socket that was closed and replaced by a new one with the same number, without a new owner, is not
+            // registered anymore, and one that we forgot about may still be, so fall back to the other operation.
+            int op = (state.nRegistered == -1) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+            int nRet = epoll_ctl(hEpoll, op, it->first, &event);
+            if (nRet != 0 && (errno == ENOENT || errno == EEXIST))
+            {
+                op = (op == EPOLL_CTL_ADD) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+                nRet = epoll_ctl(hEpoll, op, it->first, &event);
+            }
+            if (nRet != 0)
+            {
+                // Let the caller find out what is wrong with the socket
+                state.nRegistered = -1;
+                state.nReady = ERR;
+                nReady++;
+            }
+            else
+                state.nRegistered = state.nWanted;
+        }
+        ++it;
+    }
+
+    if (nReady > 0)
+        nTimeoutMs = 0;
+    size_t nMaxEvents = std::max<size_t>(1, std::min<size_t>(mapSockets.size(), MAX_EPOLL_EVENTS));
+    std::vector<struct epoll_event> vEvents(nMaxEvents);
+    int nEvents = epoll_wait(hEpoll, vEvents.data(), vEvents.size(), nTimeoutMs);
+    if (nEvents < 0)
+        return (errno == EINTR) ? nReady : SOCKET_ERROR;
+    for (int i = 0; i < nEvents; i++)
+    {
+        auto it = mapSockets.find(vEvents[i].data.fd);
+        if (it == mapSockets.end())
+            continue;
+        if (it->second.nReady == 0)
+            nReady++;
+        it->second.nReady |= FromEpollEvents(vEvents[i].events);
+    }
+    return nReady;
+#else
+    return SOCKET_ERROR;
+#endif
+}
+
+int CSocketEvents::WaitSelect(int64_t nTimeoutMs)
+{
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+
+    for (auto it = mapSockets.begin(); it != mapSockets.end();)
+    {
+        SocketState &state = it->second;
+        state.nReady = 0;
+        if (state.nWait != nWait || !IsSelectableSocket(it->first))
+        {
+            it = mapSockets.erase(it);
+            continue;
+        }
+        if (state.nWanted & RECV)
+            FD_SET(it->first, &fdsetRecv);
+        if (state.nWanted & SEND)
+            FD_SET(it->first, &fdsetSend);
+        FD_SET(it->first, &fdsetError);
+        hSocketMax = std::max(hSocketMax, it->first);
+        have_fds = true;
+        ++it;
+    }
+
+    if (!have_fds)
+    {
+        // select() fails without any sockets on Windows
+        MilliSleep(nTimeoutMs);
+        return 0;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = nTimeoutMs / 1000;
+    timeout.tv_usec = (nTimeoutMs % 1000) * 1000;
+    int nSelect = select(hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (nSelect == SOCKET_ERROR)
+        return SOCKET_ERROR;
+
+    int nReady = 0;
+    for (auto &item : mapSockets)
+    {
+        SocketState &state = item.second;
+        if (FD_ISSET(item.first, &fdsetRecv))
+            state.nReady |= RECV;
+        if (FD_ISSET(item.first, &fdsetSend))
+            state.nReady |= SEND;
+        if (FD_ISSET(item.first, &fdsetError))
+            state.nReady |= ERR;
+        if (state.nReady != 0)
+            nReady++;
+    }
+    return nReady;
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2021 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SOCKETEVENTS_H
+#define BITCOIN_SOCKETEVENTS_H
+
+#include "compat.h"
+
+#include <stdint.h>
+#include <unordered_map>
+
+/**
+ * Waits until any of a set of sockets can be read from or written to.
+ *
+ * The sockets to wait on are added before each call to Wait, and what each socket is ready for is looked up with
+ * Ready afterwards.  A socket that is not added again before the next wait is forgotten.
+ *
+ * On Linux this uses epoll.  Sockets stay registered with the kernel from one wait to the next and are only updated
+ * when the events wanted from them change.  A wait still walks every added socket to find those changes, so it is
+ * linear in the number of connections, but the kernel no longer copies and scans a descriptor set on every call and
+ * sockets are not limited to FD_SETSIZE.  Elsewhere, or if epoll can not be used, select() is used instead.
+ *
+ * Readiness is level triggered in both cases: a socket is reported for as long as it is ready, so the caller does
+ * not have to drain it.  The traffic shapers often leave data in the socket buffers on purpose.
+ */
+class CSocketEvents
+{
+public:
+    enum
+    {
+        RECV = 1,
+        SEND = 2,
+        //! An error or hangup, which is always waited for
+        ERR = 4,
+    };
+
+    //! Use epoll if it is available, unless fUseSelect is set
+    explicit CSocketEvents(bool fUseSelect = false);
+    ~CSocketEvents();
+
+    //! Whether this waits with epoll rather than select()
+    bool UsesEpoll() const { return hEpoll != -1; }
+    //! Whether epoll was compiled in and works on this system
+    static bool IsEpollAvailable();
+    //! Whether hSocket can be waited on by a CSocketEvents that was created without fUseSelect
+    static bool CanWaitOn(SOCKET hSocket);
+
+    /**
+     * Wait for the events nEvents (RECV and/or SEND) on hSocket in the next call to Wait.  nOwner tells apart the
+     * sockets that get the same number when one is closed and another one opened, such as the ids of the nodes.
+     */
+    void Add(SOCKET hSocket, int nEvents, int64_t nOwner = 0);
+
+    /**
+     * Wait up to nTimeoutMs milliseconds for one of the added sockets to become ready.  Returns the number of ready
+     * sockets, which is 0 if the wait timed out.  If the wait failed, returns SOCKET_ERROR and every added socket is
+     * reported ready to receive, so that the caller finds the broken sockets by reading them.
+     */
+    int Wait(int64_t nTimeoutMs);
+
+    //! The events that hSocket was ready for in the last call to Wait
+    int Ready(SOCKET hSocket) const;
+
+private:
+    struct SocketState
+    {
+        int64_t nOwner = 0;
+        int nWanted = 0;
+        //! The events that the socket is registered with epoll for, or -1 if it is not registered
+        int nRegistered = -1;
+        int nReady = 0;
+        //! The wait that the socket was last added for
+        uint64_t nWait = 0;
+    };
+
+    int hEpoll;
+    //! Counts the calls to Wait
+    uint64_t nWait;
+    std::unordered_map<SOCKET, SocketState> mapSockets;
+
+    int WaitEpoll(int64_t nTimeoutMs);
+    int WaitSelect(int64_t nTimeoutMs);
+
+    CSocketEvents(const CSocketEvents &) = delete;
+    CSocketEvents &operator=(const CSocketEvents &) = delete;
+};
+
+#endif // BITCOIN_SOCKETEVENTS_H
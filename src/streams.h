@@ -295,7 +295,11 @@ public:
 
     void GetAndClear(CSerializeData &data)
     {
-        data.insert(data.end(), begin(), end());
+        // Hand the buffer over instead of copying it when there is nothing to append to
+        if (data.empty() && nReadPos == 0)
+            data.swap(vch);
+        else
+            data.insert(data.end(), begin(), end());
         clear();
     }
 
@@ -325,6 +329,50 @@ public:
     }
 };
 
+/**
+ * Deserialize from a range of bytes that is owned by someone else, without copying it.  The bytes must stay valid
+ * for as long as the reader is used.
+ */
+class CMemoryReader
+{
+private:
+    const int nType;
+    const int nVersion;
+    const char *pbegin;
+    const char *pend;
+
+public:
+    CMemoryReader(int nTypeIn, int nVersionIn, const char *pbeginIn, const char *pendIn)
+        : nType(nTypeIn), nVersion(nVersionIn), pbegin(pbeginIn), pend(pendIn)
+    {
+    }
+
+    int GetType() const { return nType; }
+    int GetVersion() const { return nVersion; }
+    size_t size() const { return pend - pbegin; }
+    bool empty() const { return pbegin == pend; }
+    void read(char *pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CMemoryReader::read(): end of data");
+        memcpy(pch, pbegin, nSize);
+        pbegin += nSize;
+    }
+
+    void ignore(size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CMemoryReader::ignore(): end of data");
+        pbegin += nSize;
+    }
+
+    template <typename T>
+    CMemoryReader &operator>>(T &obj)
+    {
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+};
 
 /** Non-refcounted RAII wrapper for FILE*
  *